@@ -0,0 +1,100 @@
+#include "ephemeris.h"
+
+
+int ephemeris_wall_offset(time_t now) {
+  /* Seconds from time() to the local wall clock.  SDK 2's time() is local
+  already; SDK 3's is UTC and the watch knows its own time zone. */
+#if defined(PBL_SDK_3)
+  return localtime(&now)->tm_gmtoff;
+#else
+  return 0;
+#endif
+}
+
+
+double ephemeris_moon_phase(time_t now, int timezone_offset) {
+  /* Calculate the current moon phase from 0 to 1.  0=new, 0.25=first quarter, and 0.5=full. */
+  double diff = difftime(now, NEW_MOON) + timezone_offset;
+  double phase = diff / LUNAR_CYCLE;
+  phase = phase - (int)phase;
+  return phase;
+}
+
+
+void ephemeris_moon_image(time_t now, double phase, int *img_type, int *img_rotation) {
+  /* Determine the image_type and image_rotation to use. Phase must be in range [0,1].
+  Image types:  {0:new, 1:wax_cresc, 2:first_quarter, 3:wax_gibb, 4:full, ..., 7:wan_cresc}
+  Rotations are {0:sun_at_00, 1:sun_at_03, 2:sun_at_06, 3:sun_at_09, ...}  */
+
+  // Determine which image_type to use.
+  *img_type = (int) ((phase + 0.0625) / 0.125);
+  if (*img_type == 8) *img_type = 0;
+
+  // Determine which image_rotation to use.
+  struct tm *now_cal = localtime(&now);
+  int h = now_cal->tm_hour;
+  int m = now_cal->tm_min;
+  int month = now_cal->tm_mon;
+  int day = now_cal->tm_mday;
+  double hour = h + (m / 60.0);
+  double rotation = hour / 24.0;
+  rotation = rotation - (int)rotation;
+  *img_rotation = (int) ((rotation+0.0625) / 0.125);
+  if (*img_rotation == 8) *img_rotation = 0;
+
+  // Easter Egg
+  if (month == 4 && day == 4) {
+    *img_type = 8;
+    *img_rotation = 0;
+  }
+}
+
+
+void ephemeris_roll_epochs(time_t now, time_t *prev_epoch, time_t *next_epoch) {
+  /* Check to see that the 'next' time is still in the future. If not,
+  set it to 'prev' and set 'next' to INF. */
+  if (difftime(now, *next_epoch)>0) {
+    *prev_epoch = *next_epoch;
+    *next_epoch = INF;
+  }
+}
+
+
+bool ephemeris_assign_epoch(time_t now, time_t incoming_epoch, time_t *prev_epoch, time_t *next_epoch) {
+  /* Given a rise or set time, determine if it should replace either 'next' or 'prev' values.
+  A)   incoming < prev < now < next  Shouldn't happen.  If it does, don't update any times.
+  B)   prev < incoming < now < next  Incoming time in past, but more recent than prev. Update prev time.
+  C)   prev < now < incoming < next  Incoming time is in the future, but sooner than next. Use incoming.
+  D)   prev < now < next < incoming  Incoming time is in the future after next.  Don't update.
+  Returns false in cases A and D. */
+  if (difftime(*prev_epoch, incoming_epoch)>0) {
+    return false;
+  }
+  else if (difftime(incoming_epoch, *prev_epoch)>0 && difftime(now, incoming_epoch)>0) {
+    *prev_epoch = incoming_epoch;
+  }
+  else if (difftime(incoming_epoch, now)>0 && difftime(*next_epoch, incoming_epoch)>0) {
+    *next_epoch = incoming_epoch;
+  }
+  else if (difftime(incoming_epoch, *next_epoch)>0) {
+    return false;
+  }
+  return true;
+}
+
+
+time_t ephemeris_select_epoch(time_t now, time_t prev_epoch, time_t next_epoch) {
+  /* The 'next' epoch if it is within 24 hours, else the 'prev' one if that
+  is, else INVALID. */
+  if (difftime(next_epoch, now)<86400) return next_epoch;
+  if (difftime(now, prev_epoch)<86400) return prev_epoch;
+  return INVALID;
+}
+
+
+bool ephemeris_refresh_due(time_t now, time_t time_stamp) {
+  /* Check the current time with time of last check.  Return
+  true if greater than 15 minutes. */
+  time_t time_passed = now - time_stamp;
+  return (time_stamp == 0 || time_passed >= TIMEOUT);
+}
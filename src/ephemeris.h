@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Sun and moon bookkeeping.  Nothing here touches the UI, so the host tools
+build it as it is. */
+
+static const time_t INF = (time_t) 2147483640;      // 7 seconds before 2038 event.
+static const time_t ZERO = (time_t) 0;
+static const time_t INVALID = (time_t) 666;         // no rise or set within a day of now
+static const time_t NEW_MOON = (time_t) 1393678800; // A recent new moon at March 1, 2014 13:00 UT
+static const double LUNAR_CYCLE = 2551442.98;       // In seconds.
+static const time_t TIMEOUT = 900;                  // Seconds between weather checks
+
+int ephemeris_wall_offset(time_t now);
+double ephemeris_moon_phase(time_t now, int timezone_offset);
+void ephemeris_moon_image(time_t now, double phase, int *img_type, int *img_rotation);
+void ephemeris_roll_epochs(time_t now, time_t *prev_epoch, time_t *next_epoch);
+bool ephemeris_assign_epoch(time_t now, time_t incoming_epoch, time_t *prev_epoch, time_t *next_epoch);
+time_t ephemeris_select_epoch(time_t now, time_t prev_epoch, time_t next_epoch);
+bool ephemeris_refresh_due(time_t now, time_t time_stamp);
@@ -0,0 +1,180 @@
+#include <pebble.h>
+#include "glyphs.h"
+#include "raster.h"
+
+
+static const char *GLYPH_STRINGS[GLYPH_COUNT] = {
+  "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", ":", "-", "\u00B0"
+};
+
+
+GlyphAtlas* glyph_atlas_create(GFont font, int16_t height, bool white) {
+  /* Measure each glyph in 'font' and cut a blank atlas into one sub-bitmap
+  per cell.  The sub-bitmaps share the atlas's pixels, which stay blank
+  until glyph_atlas_render. */
+  GlyphAtlas *atlas = malloc(sizeof(GlyphAtlas));
+  if (atlas == NULL) return NULL;
+  atlas->font = font;
+  atlas->height = height;
+  atlas->white = white;
+  atlas->rendered = false;
+
+  int width = 0;
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    GSize size = graphics_text_layout_get_content_size(GLYPH_STRINGS[i], font, GRect(0, 0, 2 * height, height),
+                                                       GTextOverflowModeFill, GTextAlignmentLeft);
+    atlas->widths[i] = size.w;
+    width += size.w;
+  }
+
+  // Black digits on white for And, or white on black for Or; on color
+  // screens the white or black around them is clear.
+  if (white) {
+    atlas->image = raster_create_mask(GSize(width, height), GColorClear, GColorWhite);
+  } else {
+    atlas->image = raster_create_mask(GSize(width, height), GColorBlack, GColorClear);
+  }
+  raster_fill(atlas->image, white ? GColorBlack : GColorWhite);
+  for (int i = 0, x = 0; i < GLYPH_COUNT; x += atlas->widths[i++]) {
+    atlas->glyphs[i] = gbitmap_create_as_sub_bitmap(atlas->image, GRect(x, 0, atlas->widths[i], height));
+  }
+  return atlas;
+}
+
+
+void glyph_atlas_destroy(GlyphAtlas *atlas) {
+  if (atlas == NULL) return;
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    gbitmap_destroy(atlas->glyphs[i]);
+  }
+  gbitmap_destroy(atlas->image);
+  free(atlas);
+}
+
+
+void glyph_atlas_render(GlyphAtlas *atlas, Layer *layer, GContext *ctx) {
+  /* Draw each glyph white on black in the middle of 'layer', which on a
+  round screen is the only place whole rows are stored, and copy its pixels
+  out of the frame buffer into its cell.  Only the first call does
+  anything. */
+  if (atlas == NULL || atlas->rendered) return;
+  GRect bounds = layer_get_bounds(layer);
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_context_set_text_color(ctx, GColorWhite);
+
+  for (int i = 0, atlas_x = 0; i < GLYPH_COUNT; atlas_x += atlas->widths[i++]) {
+    GRect box = GRect((bounds.size.w - atlas->widths[i]) / 2, (bounds.size.h - atlas->height) / 2,
+                      atlas->widths[i], atlas->height);
+    graphics_fill_rect(ctx, box, 0, GCornerNone);
+    graphics_draw_text(ctx, GLYPH_STRINGS[i], atlas->font, box, GTextOverflowModeFill, GTextAlignmentLeft, NULL);
+
+    GBitmap *frame = graphics_capture_frame_buffer(ctx);
+    if (frame == NULL) return;         // try again next frame
+    for (int y = 0; y < box.size.h; y++) {
+      for (int x = 0; x < box.size.w; x++) {
+        if (raster_is_white(frame, box.origin.x + x, box.origin.y + y)) {
+          raster_set_pixel(atlas->image, atlas_x + x, y, atlas->white ? GColorWhite : GColorBlack);
+        }
+      }
+    }
+    graphics_release_frame_buffer(ctx, frame);
+  }
+  atlas->rendered = true;
+}
+
+
+int glyph_index(const char **text) {
+  /* The atlas cell for the character at *text, or -1 if there is none, and
+  step past it.  The degree sign is the two bytes of its UTF-8. */
+  const char *c = *text;
+  if (c[0] == '\xC2' && c[1] == '\xB0') {
+    *text += 2;
+    return 12;
+  }
+  *text += 1;
+  if (c[0] >= '0' && c[0] <= '9') return c[0] - '0';
+  if (c[0] == ':') return 10;
+  if (c[0] == '-') return 11;
+  return -1;
+}
+
+
+GlyphText* glyph_text_create(GRect frame, const GlyphAtlas *atlas, GTextAlignment alignment, GCompOp op, GColor background) {
+  GlyphText *text = malloc(sizeof(GlyphText));
+  if (text == NULL) return NULL;
+  text->atlas = atlas;
+  text->alignment = alignment;
+  text->layer = bitmap_layer_create(frame);
+  bitmap_layer_set_background_color(text->layer, background);
+
+  GRect cell = GRect(0, 0, atlas->widths[0], atlas->height);
+  for (int i = 0; i < GLYPH_CELLS_MAX; i++) {
+    text->cells[i] = bitmap_layer_create(cell);
+    bitmap_layer_set_background_color(text->cells[i], GColorClear);
+    bitmap_layer_set_compositing_mode(text->cells[i], op);
+    layer_set_hidden(bitmap_layer_get_layer(text->cells[i]), true);
+    layer_add_child(bitmap_layer_get_layer(text->layer), bitmap_layer_get_layer(text->cells[i]));
+    text->shown[i] = -1;
+    text->shown_x[i] = 0;
+  }
+  return text;
+}
+
+
+void glyph_text_destroy(GlyphText *text) {
+  if (text == NULL) return;
+  for (int i = 0; i < GLYPH_CELLS_MAX; i++) {
+    bitmap_layer_destroy(text->cells[i]);
+  }
+  bitmap_layer_destroy(text->layer);
+  free(text);
+}
+
+
+Layer* glyph_text_get_layer(GlyphText *text) {
+  return bitmap_layer_get_layer(text->layer);
+}
+
+
+int glyph_text_set_text(GlyphText *text, const char *string) {
+  /* Show 'string', changing only the cells whose glyph or place differs
+  from what they show now; those are the only layers marked dirty.  Anything
+  past GLYPH_CELLS_MAX characters is dropped. */
+  int glyphs[GLYPH_CELLS_MAX];
+  int count = 0;
+  while (*string && count < GLYPH_CELLS_MAX) {
+    glyphs[count++] = glyph_index(&string);
+  }
+
+  int width = layer_get_bounds(bitmap_layer_get_layer(text->layer)).size.w;
+  int line_w = 0;
+  for (int i = 0; i < count; i++) {
+    if (glyphs[i] >= 0) line_w += text->atlas->widths[glyphs[i]];
+  }
+  int left = 0;
+  if (text->alignment == GTextAlignmentRight) left = width - line_w;
+  if (text->alignment == GTextAlignmentCenter) left = (width - line_w) / 2;
+
+  int changed = 0;
+  int next_x = left;
+  for (int i = 0; i < GLYPH_CELLS_MAX; i++) {
+    int glyph = i < count ? glyphs[i] : -1;
+    int glyph_w = glyph < 0 ? 0 : text->atlas->widths[glyph];
+    int x = next_x;
+    next_x += glyph_w;
+    if (glyph == text->shown[i] && (glyph < 0 || x == text->shown_x[i])) continue;
+
+    Layer *cell = bitmap_layer_get_layer(text->cells[i]);
+    if (glyph < 0) {
+      layer_set_hidden(cell, true);
+    } else {
+      layer_set_frame(cell, GRect(x, 0, glyph_w, text->atlas->height));
+      bitmap_layer_set_bitmap(text->cells[i], text->atlas->glyphs[glyph]);
+      if (text->shown[i] < 0) layer_set_hidden(cell, false);
+      text->shown_x[i] = x;
+    }
+    text->shown[i] = glyph;
+    changed++;
+  }
+  return changed;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <pebble.h>
+
+/* Short lines of digits drawn from a pre-rendered atlas instead of a
+TextLayer: one BitmapLayer per character cell, showing a sub-bitmap of the
+atlas.  Setting new text only touches the cells whose character changed, and
+redrawing a cell is a blit rather than a text layout.  An atlas is drawn
+once, on the first frame, with a system font; the SDK has no way to draw
+into a bitmap, so the glyphs go to the frame buffer under the face and are
+copied out of it.  Each glyph's cell is as wide as the font's own advance,
+so the digits land where a TextLayer would put them. */
+
+#define GLYPH_COUNT 13                 // "0123456789:-" and a degree sign, the cells of an atlas in order
+#define GLYPH_CELLS_MAX 5              // longest text, "00:00"
+
+typedef struct {
+  GBitmap *image;                      // a mask (raster.h), one row of cells
+  GBitmap *glyphs[GLYPH_COUNT];        // sub-bitmaps of image, one per cell
+  uint8_t widths[GLYPH_COUNT];
+  int16_t height;
+  GFont font;
+  bool white;                          // white digits, else black
+  bool rendered;
+} GlyphAtlas;
+
+typedef struct {
+  BitmapLayer *layer;                  // the frame; its background shows between cells
+  BitmapLayer *cells[GLYPH_CELLS_MAX];
+  const GlyphAtlas *atlas;
+  GTextAlignment alignment;
+  int8_t shown[GLYPH_CELLS_MAX];       // glyph in each cell, -1 for none
+  int16_t shown_x[GLYPH_CELLS_MAX];
+} GlyphText;
+
+GlyphAtlas* glyph_atlas_create(GFont font, int16_t height, bool white);
+void glyph_atlas_destroy(GlyphAtlas *atlas);
+
+// Call from the update proc of a layer at the top left of the screen that is
+// drawn before the rest of the face, which then paints over what it draws.
+void glyph_atlas_render(GlyphAtlas *atlas, Layer *layer, GContext *ctx);
+
+int glyph_index(const char **text);
+
+// Cells are composited with 'op' over 'background' (GColorClear for none).
+GlyphText* glyph_text_create(GRect frame, const GlyphAtlas *atlas, GTextAlignment alignment, GCompOp op, GColor background);
+void glyph_text_destroy(GlyphText *text);
+Layer* glyph_text_get_layer(GlyphText *text);
+int glyph_text_set_text(GlyphText *text, const char *string);  // returns the number of cells changed
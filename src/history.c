@@ -0,0 +1,239 @@
+/*
+  Samples are kept in a byte ring of variable-length records, each one
+  delta-encoded against the record before it:
+
+    varint   (minutes since the previous record << 2) | tag
+    varint   zigzag payload (absent for TAG_REPEAT)
+
+    tag 0  temperature changed, payload is the change
+    tag 1  temperature repeated, no payload
+    tag 2  sunrise, payload is the event minute minus the record minute
+    tag 3  sunset, same as sunrise
+
+  A half-hourly temperature costs one or two bytes, so a few days fit.
+  The header holds the minute and temperature the oldest record is relative
+  to.  When the ring fills, the oldest records are folded into the header.
+*/
+
+#include <pebble.h>
+#include "history.h"
+
+#define RING_SIZE (PERSIST_DATA_MAX_LENGTH - 8)
+
+enum {
+  TAG_TEMPERATURE = 0,
+  TAG_REPEAT = 1,
+  TAG_SUNRISE = 2,
+  TAG_SUNSET = 3
+};
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t base_minute;          // minute the oldest record is relative to
+  int16_t base_temperature;      // temperature the oldest record is relative to
+  uint8_t head;                  // ring index of the oldest byte
+  uint8_t length;                // bytes in use
+  uint8_t ring[RING_SIZE];
+} History;
+
+typedef struct {
+  uint16_t pos;                  // bytes consumed, counted from head
+  uint32_t minute;
+  int32_t temperature;
+} Cursor;
+
+typedef struct {
+  bool found;
+  uint16_t pos;                  // where its record starts, counted from head
+  HistorySample sample;
+} Newest;
+
+static History history;
+static uint32_t tail_minute = 0;       // minute of the newest record
+static int32_t tail_temperature = 0;   // temperature as of the newest record
+static Newest newest[4];               // newest sample of each HistoryKind, so history_last needn't decode
+
+
+/*  ENCODING
+    --------  */
+static uint32_t zigzag_encode(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+
+static int32_t zigzag_decode(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+
+static int write_varint(uint8_t *out, uint32_t value) {
+  /* Seven bits per byte, high bit set on all but the last. */
+  int n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+
+static uint32_t read_varint(Cursor *cursor) {
+  uint32_t value = 0;
+  int shift = 0;
+  while (cursor->pos < history.length && shift < 32) {
+    uint8_t byte = history.ring[(history.head + cursor->pos) % RING_SIZE];
+    cursor->pos++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) break;
+    shift += 7;
+  }
+  return value;
+}
+
+
+static bool read_record(Cursor *cursor, HistorySample *sample) {
+  /* Decode the record at the cursor and advance past it.  Returns false
+  at the end of the ring. */
+  if (cursor->pos >= history.length) return false;
+
+  uint32_t header = read_varint(cursor);
+  int tag = header & 3;
+  cursor->minute += header >> 2;
+  sample->time = (time_t)cursor->minute * 60;
+
+  switch (tag) {
+    case TAG_TEMPERATURE:
+      cursor->temperature += zigzag_decode(read_varint(cursor));
+      // fall through
+    case TAG_REPEAT:
+      sample->kind = HISTORY_TEMPERATURE;
+      sample->value = cursor->temperature;
+      break;
+    default:
+      sample->kind = (tag == TAG_SUNRISE) ? HISTORY_SUNRISE : HISTORY_SUNSET;
+      sample->value = ((int32_t)cursor->minute + zigzag_decode(read_varint(cursor))) * 60;
+      break;
+  }
+  return true;
+}
+
+
+static Cursor first_record() {
+  return (Cursor) { .pos = 0, .minute = history.base_minute, .temperature = history.base_temperature };
+}
+
+
+static void drop_oldest() {
+  /* Fold the oldest record into the header to make room. */
+  Cursor cursor = first_record();
+  HistorySample sample;
+  read_record(&cursor, &sample);
+  history.head = (history.head + cursor.pos) % RING_SIZE;
+  history.length -= cursor.pos;
+  history.base_minute = cursor.minute;
+  history.base_temperature = cursor.temperature;
+
+  for (int kind = 0; kind < 4; kind++) {
+    if (newest[kind].pos < cursor.pos) {
+      newest[kind].found = false;
+    } else {
+      newest[kind].pos -= cursor.pos;
+    }
+  }
+}
+
+
+static void find_tail() {
+  /* Walk the ring to recover the state that new records build on, and the
+  newest sample of each kind. */
+  memset(newest, 0, sizeof(newest));
+  Cursor cursor = first_record();
+  HistorySample sample;
+  uint16_t pos = cursor.pos;
+  while (read_record(&cursor, &sample)) {
+    newest[sample.kind] = (Newest) { .found = true, .pos = pos, .sample = sample };
+    pos = cursor.pos;
+  }
+  tail_minute = cursor.minute;
+  tail_temperature = cursor.temperature;
+}
+
+
+/*  PUBLIC
+    ------  */
+void history_load(uint32_t key) {
+  memset(&history, 0, sizeof(history));
+  if (persist_exists(key) && persist_get_size(key) == (int)sizeof(history)) {
+    persist_read_data(key, &history, sizeof(history));
+    if (history.head >= RING_SIZE || history.length > RING_SIZE) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Saved history is corrupt, starting over.");
+      memset(&history, 0, sizeof(history));
+    }
+  }
+  find_tail();
+}
+
+
+void history_save(uint32_t key) {
+  persist_write_data(key, &history, sizeof(history));
+}
+
+
+void history_add(HistoryKind kind, time_t time, int32_t value) {
+  /* Append one sample, dropping the oldest ones if there is no room. */
+  uint32_t minute = (uint32_t)(time / 60);
+  if (history.length == 0) {
+    history.base_minute = tail_minute = minute;
+    history.base_temperature = tail_temperature = (kind == HISTORY_TEMPERATURE) ? value : tail_temperature;
+  }
+
+  // The clock can go backwards (e.g. the user sets it); keep records in order.
+  uint32_t elapsed = (minute > tail_minute) ? minute - tail_minute : 0;
+  if (elapsed > 0x3FFFFFFF) elapsed = 0x3FFFFFFF;
+
+  uint8_t record[12];
+  int n;
+  // What read_record will decode this record as: sun events keep the minute.
+  HistorySample sample = { .kind = kind, .time = (time_t)(tail_minute + elapsed) * 60, .value = value };
+  if (kind == HISTORY_TEMPERATURE && value == tail_temperature) {
+    n = write_varint(record, (elapsed << 2) | TAG_REPEAT);
+  } else if (kind == HISTORY_TEMPERATURE) {
+    n = write_varint(record, (elapsed << 2) | TAG_TEMPERATURE);
+    n += write_varint(record + n, zigzag_encode(value - tail_temperature));
+    tail_temperature = value;
+  } else {
+    int tag = (kind == HISTORY_SUNRISE) ? TAG_SUNRISE : TAG_SUNSET;
+    n = write_varint(record, (elapsed << 2) | tag);
+    n += write_varint(record + n, zigzag_encode(value / 60 - (int32_t)(tail_minute + elapsed)));
+    sample.value = (value / 60) * 60;
+  }
+  tail_minute += elapsed;
+
+  while (history.length + n > RING_SIZE) {
+    drop_oldest();
+  }
+  newest[kind] = (Newest) { .found = true, .pos = history.length, .sample = sample };
+  for (int i = 0; i < n; i++) {
+    history.ring[(history.head + history.length) % RING_SIZE] = record[i];
+    history.length++;
+  }
+}
+
+
+bool history_last(HistoryKind kind, HistorySample *sample) {
+  /* The newest sample of the given kind, kept up to date as records are
+  added and dropped. */
+  if (!newest[kind].found) return false;
+  *sample = newest[kind].sample;
+  return true;
+}
+
+
+void history_foreach(time_t since, HistoryCallback callback, void *context) {
+  /* Call back with every sample taken at or after 'since', oldest first. */
+  Cursor cursor = first_record();
+  HistorySample sample;
+  while (read_record(&cursor, &sample)) {
+    if (sample.time >= since && !callback(&sample, context)) return;
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <pebble.h>
+
+/* A few days of temperature and sunrise/sunset samples, small enough to be
+saved under a single persist key. */
+
+typedef enum {
+  HISTORY_TEMPERATURE = 0,
+  HISTORY_SUNRISE = 2,
+  HISTORY_SUNSET = 3
+} HistoryKind;
+
+typedef struct {
+  HistoryKind kind;
+  time_t time;         // when the sample was taken, to the minute
+  int32_t value;       // temperature, or the sunrise/sunset epoch
+} HistorySample;
+
+// Return false to stop iterating.
+typedef bool (*HistoryCallback)(const HistorySample *sample, void *context);
+
+void history_load(uint32_t key);
+void history_save(uint32_t key);
+void history_add(HistoryKind kind, time_t time, int32_t value);
+bool history_last(HistoryKind kind, HistorySample *sample);
+void history_foreach(time_t since, HistoryCallback callback, void *context);
@@ -1,4 +1,33 @@
 var locationOptions = { "timeout": 15000, "maximumAge": 60000 };  // Wait 15s for pos to return. Cache pos for 60s.
+var traceMessages = false;  // Log every AppMessage as a TRACE line for tools/replay.
+
+// Push mode: follow the phone's position and send the watch new data only when
+// it has moved, the temperature has changed or a new day has started.  The watch
+// stops asking for data while this is on.
+var pushMode = false;
+var pushMoveKm = 5;          // Distance that counts as a move.
+var pushTempDelta = 3;       // Temperature change (F) worth sending.
+var pushCheckMinutes = 15;   // How often to look at the weather while pushing.
+var pushPosition = null;     // Latest position from watchPosition.
+var pushed = null;           // What the watch was last sent: latitude, longitude, temperature, day.
+
+
+function trace(direction, payload) {
+    // One line per message: TRACE <direction> <UTC seconds> key=value ...
+    // '>' is phone to watch, '<' is watch to phone.
+    if (!traceMessages) return;
+    var fields = [];
+    for (var key in payload) {
+        fields.push(key + "=" + payload[key]);
+    }
+    console.log("TRACE " + direction + " " + Math.round(Date.now() / 1000) + " " + fields.join(" "));
+}
+
+
+function sendMessage(payload) {
+    trace(">", payload);
+    Pebble.sendAppMessage(payload);
+}
 
 
 function isJSON(text) {
@@ -26,7 +55,8 @@ function transferCanceled(evt) {
 }
 
 
-function locationSuccess(location) {
+function requestWeather(location, onReport, onFailure) {
+    // Fetch the weather at a position and hand the watch message to onReport.
     var tzOffset = new Date().getTimezoneOffset() * 60;
     var req = new XMLHttpRequest();
     var url = "http://api.openweathermap.org/data/2.5/weather?" + "lat=" + location.coords.latitude + "&lon=" + location.coords.longitude + "&cnt=1" + "&APPID=fbe9f05dbefbee75e2ffdcf3b069a893";
@@ -50,35 +80,38 @@ function locationSuccess(location) {
                 } 
                 catch (e) {
                     console.log("JS: Unable to convert text to JSON object.");
-                    Pebble.sendAppMessage( {"status": "failed", "tzOffset": tzOffset} );
+                    onFailure();
                     return;
                 }
                 var temperature = Math.round((response.main.temp-273.15)*1.8 + 32.0);
                 var sunrise = response.sys.sunrise;
                 var sunset = response.sys.sunset;
                 var cityID = response.id;
-                console.log("JS: Sending weather...");
-                var message = ["reporting", sunrise, sunset, temperature, tzOffset, cityID]
+                var latitude = Math.round(location.coords.latitude * 100);
+                var longitude = Math.round(location.coords.longitude * 100);
+                var message = ["reporting", sunrise, sunset, temperature, tzOffset, cityID, latitude, longitude]
                 console.log(message.toString());
-                Pebble.sendAppMessage({
+                onReport({
                     "status": "reporting", 
                     "sunrise": sunrise, 
                     "sunset": sunset, 
                     "temperature": temperature, 
                     "tzOffset": tzOffset,
-                    "cityID": cityID
+                    "cityID": cityID,
+                    "latitude": latitude,
+                    "longitude": longitude
                 });
             }
 
             else {
                 console.log('JS: Response text is not in JSON format.');
-                Pebble.sendAppMessage( {"status": "failed", "tzOffset": tzOffset} );
+                onFailure();
             }
         }
 
         else {
             console.log("JS: Error communicating with Open Weather Map.");
-            Pebble.sendAppMessage( {"status": "failed", "tzOffset": tzOffset} );
+            onFailure();
         }
     }
 
@@ -88,20 +121,105 @@ function locationSuccess(location) {
 }
 
 
+function sendFailed() {
+    var tzOffset = new Date().getTimezoneOffset() * 60;
+    sendMessage( {"status": "failed", "tzOffset": tzOffset} );
+}
+
+
+function sendReport(report) {
+    // Replies to the watch say whether it can stop asking.
+    if (pushMode) {
+        report.push = 1;
+        pushed = {
+            "latitude": report.latitude,
+            "longitude": report.longitude,
+            "temperature": report.temperature,
+            "day": new Date().toDateString()
+        };
+    }
+    console.log("JS: Sending weather...");
+    sendMessage(report);
+}
+
+
+function locationSuccess(location) {
+    requestWeather(location, sendReport, sendFailed);
+}
+
+
+function distanceKm(latitude1, longitude1, latitude2, longitude2) {
+    // Flat-earth distance between two positions in hundredths of a degree;
+    // plenty for telling whether the phone has moved a few km.
+    var radians = Math.PI / 18000;
+    var x = (longitude2 - longitude1) * radians * Math.cos((latitude1 + latitude2) / 2 * radians);
+    var y = (latitude2 - latitude1) * radians;
+    return Math.sqrt(x * x + y * y) * 6371;
+}
+
+
+function hasMoved(location) {
+    if (pushed === null) return true;
+    var latitude = Math.round(location.coords.latitude * 100);
+    var longitude = Math.round(location.coords.longitude * 100);
+    return distanceKm(pushed.latitude, pushed.longitude, latitude, longitude) >= pushMoveKm;
+}
+
+
+function pushIfChanged(report) {
+    // Send a report only if the watch would show something different.
+    if (pushed === null ||
+        distanceKm(pushed.latitude, pushed.longitude, report.latitude, report.longitude) >= pushMoveKm ||
+        Math.abs(report.temperature - pushed.temperature) >= pushTempDelta ||
+        new Date().toDateString() != pushed.day) {
+        sendReport(report);
+    } else {
+        console.log("JS: Nothing new for the watch.");
+    }
+}
+
+
+function checkWeather() {
+    // Failures stay quiet in push mode; the next check tries again.
+    if (pushPosition === null) return;
+    requestWeather(pushPosition, pushIfChanged, function() {});
+}
+
+
+function positionChanged(location) {
+    pushPosition = location;
+    if (hasMoved(location)) checkWeather();
+}
+
+
+function positionError(error) {
+    console.log("JS: No position update: " + error.message);
+}
+
+
+function startPushing() {
+    window.navigator.geolocation.watchPosition(positionChanged, positionError, locationOptions);
+    setInterval(checkWeather, pushCheckMinutes * 60000);
+}
+
+
 function locationError(error) {
     console.log("JS: Failed to get coords: " + error.message + "\n");
-    var tzOffset = new Date().getTimezoneOffset() * 60;
-    Pebble.sendAppMessage( {"status": "failed", "tzOffset": tzOffset} );
+    sendFailed();
 }
 
 
 function readyHandler(e) {
     console.log("JS: Ready.");
-    Pebble.sendAppMessage( {"status": "ready"} );
+    var message = {"status": "ready"};
+    if (pushMode) message.push = 1;
+    sendMessage(message);
+    if (pushMode) startPushing();
 }
 
 
 function receivedHandler(message) {
+    trace("<", message.payload);
     if(message.payload.status == "retrieve") {
         console.log("JS: Recieved status \"retrieve\", getting location...");
         window.navigator.geolocation.getCurrentPosition(locationSuccess, locationError, locationOptions);
@@ -0,0 +1,22 @@
+#pragma once
+
+/* AppMessage and persistent storage keys. */
+
+enum {
+  KEY_STATUS = 0,
+  KEY_TZOFFSET = 1,
+  KEY_SUNRISE = 2,
+  KEY_SUNSET = 3,
+  KEY_TEMPERATURE = 4,
+  KEY_CITYID = 5,
+  KEY_LATITUDE = 6,
+  KEY_LONGITUDE = 7,
+  KEY_PUSH = 9,
+  KEY_PREV_SUNRISE = 20,
+  KEY_PREV_SUNSET = 21,
+  KEY_NEXT_SUNRISE = 22,
+  KEY_NEXT_SUNSET = 23,
+  KEY_TIME_STAMP = 24,
+  KEY_TEMP_TIME_STAMP = 25,
+  KEY_HISTORY = 26
+};
@@ -1,38 +1,55 @@
 /*
   Window window
     Layer window_layer
+        Layer glyph_render_layer              (draws the digit atlases, once, under the face)
         Layer background_layer
             BitmapLayer(face_bg_white_layer)
             Layer daylight_layer
-                GPath daylight_path
-            Layer TextLayer(time_text_layer)
+                GBitmap sky_image             (redrawn when the twilight bands move)
+            GlyphText(time_text)              (cells from time_atlas)
             BitmapLayer(face_bg_black_layer)
+            BitmapLayer(w_spark_layer)
+            BitmapLayer(b_spark_layer)
         Layer sun_layer
             BitmapLayer(b_sun_layer)
             BitmapLayer(w_sun_layer)
         Layer moon_layer
-            BitmapLayer(b_moon_layer)
-            BitmapLayer(w_moon_layer)
-        Layer TextLayer(next_sunrise_text_layer)
-        Layer TextLayer(next_sunset_text_layer)
-        Layer TextLayer(prev_sunrise_text_layer)
-        Layer TextLayer(prev_sunset_text_layer)
+            BitmapLayer(b_moon_layer)         (a cell of b_moons_image)
+            BitmapLayer(w_moon_layer)         (a cell of w_moons_image)
         Layer BitmapLayer(noti_layer)
         Layer BitmapLayer(battery_layer)
+        GlyphText(date_text)                  (cells from small_atlas)
+        GlyphText(temp_text)                  (cells from small_atlas)
+        Layer detail_layer                    (only while summoned by a tap)
+            TextLayer(prev_sunrise_text_layer)
+            TextLayer(prev_sunset_text_layer)
+            TextLayer(next_sunrise_text_layer)
+            TextLayer(next_sunset_text_layer)
+            TextLayer(day_length_text_layer)
+            TextLayer(moon_phase_text_layer)
+            TextLayer(data_age_text_layer)
 */
 
 #include <pebble.h>
 #include <time.h>
 #include "natural.h"
+#include "keys.h"
+#include "ephemeris.h"
+#include "glyphs.h"
+#include "history.h"
+#include "raster.h"
+#include "sky.h"
 
-static const time_t INF = (time_t) 2147483640;      // 7 seconds before 2038 event.
-static const time_t ZERO = (time_t) 0;
-static const time_t INVALID = (time_t)  666;
-static const time_t NEW_MOON = (time_t) 1393678800; // A recent new moon at March 1, 2014 13:00 UT
-static const double LUNAR_CYCLE = 2551442.98;       // In seconds.
-static const time_t TIMEOUT = 900;                  // Seconds between weather checks
 static const time_t ERROR_TIMEOUT = 120;            // Wait time after error before retrying get_weather
+static const uint32_t DETAIL_TIMEOUT = 5000;        // Milliseconds the detail overlay stays up after a tap
+static const time_t HISTORY_INTERVAL = 1800;        // Seconds between temperature samples kept in history
+static const time_t SPARK_GAP = 7200;               // Samples further apart than this are not joined
+static const time_t SPARK_LEAD = 3600;              // Blank wedge left ahead of the newest sample
+static const time_t TABLE_RETRY = 3600;             // Wait before asking the sun table again when it has no event
+static const time_t TEMP_MAX_AGE = 3600;            // Temperatures older than this are not shown...
+static const time_t PUSH_MAX_AGE = 90000;           // ...unless the phone is pushing, which it does at least daily
 static const bool DEBUG_MODE = false;
+static const bool TRACE_MODE = false;               // Log state after each message, for tools/replay
 
 static Window *window;
 
@@ -40,6 +57,8 @@ static Layer *background_layer;
 static BitmapLayer *b_clockface_layer, *w_clockface_layer;
 static GBitmap *b_clockface_image, *w_clockface_image;
 static Layer *daylight_layer;
+static BitmapLayer *b_spark_layer, *w_spark_layer;
+static GBitmap *b_spark_image, *w_spark_image;
 
 static Layer *sun_layer;
 static BitmapLayer *b_sun_layer, *w_sun_layer;
@@ -47,7 +66,8 @@ static GBitmap *b_sun_image, *w_sun_image;
 
 static Layer *moon_layer;
 static BitmapLayer *b_moon_layer, *w_moon_layer;
-static GBitmap *b_moon_image, *w_moon_image;
+static GBitmap *b_moons_image, *w_moons_image;      // every phase, one cell each
+static GBitmap *b_moon_image, *w_moon_image;        // sub-bitmaps moved to the cell shown
 
 static BitmapLayer *noti_layer;
 static GBitmap *refresh_image, *error_image, *empty_image, *no_bluetooth_image;
@@ -55,35 +75,63 @@ static GBitmap *refresh_image, *error_image, *empty_image, *no_bluetooth_image;
 static BitmapLayer *battery_layer;
 static GBitmap *batt_100_image, *batt_80_image, *batt_60_image, *batt_40_image, *batt_20_image, *batt_10_image, *batt_charge_image;
 
-static TextLayer *time_text_layer, *date_text_layer, *temp_text_layer;
+static GlyphAtlas *time_atlas, *small_atlas;
+static GlyphText *time_text, *date_text, *temp_text;
+static Layer *glyph_render_layer;
 
 static char time_buffer[16], date_buffer[16], temp_buffer[16], log_buffer[256];
+
+/* The detail overlay is created on a tap and destroyed by detail_timer, so
+it holds no heap and costs nothing to redraw the rest of the time.  Each row
+is a label on the left and its value on the right, in separate TextLayers,
+so the values line up whatever the font's widths. */
+typedef enum {
+  DETAIL_PREV_SUNRISE,
+  DETAIL_PREV_SUNSET,
+  DETAIL_NEXT_SUNRISE,
+  DETAIL_NEXT_SUNSET,
+  DETAIL_DAY_LENGTH,
+  DETAIL_MOON_PHASE,
+  DETAIL_DATA_AGE,
+  DETAIL_ROWS
+} DetailRow;
+
+static const char *DETAIL_LABELS[DETAIL_ROWS] = { "Rose", "Set", "Rises", "Sets", "Day", "Moon", "Data" };
+
+typedef struct {
+  Layer *detail_layer;
+  TextLayer *label_layers[DETAIL_ROWS];
+  TextLayer *value_layers[DETAIL_ROWS];
+  char values[DETAIL_ROWS][16];
+} DetailOverlay;
+
+static DetailOverlay *detail_overlay = NULL;
+static AppTimer *detail_timer = NULL;
 static int current_image_index[2] = {99, 99};       // points to nothing
-static int timezone_offset = 0;                     // actual epoch - time(NULL)
+static int timezone_offset = 0;                     // actual epoch - time(NULL), always 0 on SDK 3
 static int temperature = -999;                      // current temp in fahrenheiht
 static int cityID = -999;                           // identifier for city from openweathermap
+static int32_t latitude = 0, longitude = 0;         // hundredths of a degree, from the phone's position
+static bool location_missing = true;                // no position yet, so the sun table can't be used
+static time_t table_retry_time = 0;                 // don't look in the sun table again before this
+static SkyState table_horizon = SKY_UNKNOWN;        // today's polar day or night from the sun table
 static bool timezone_missing = true;                // necessary? for moon_update maybe
 static bool getting_weather = false;                // prevent calling get_weather() twice
 static bool js_ready = false;                       // js ready to receive requests
+static bool push_mode = false;                      // js sends changes by itself, so don't ask
 static bool bluetooth_connected = false;            // whether or not bluetooth is connected
 static time_t time_stamp = 0;                       // time of last weather check
 static time_t temp_time_stamp = 0;                  // time that temperature was last received
 static time_t prev_sunrise_epoch, next_sunrise_epoch, prev_sunset_epoch, next_sunset_epoch;
-
-enum {
-  KEY_STATUS = 0,
-  KEY_TZOFFSET = 1,
-  KEY_SUNRISE = 2,
-  KEY_SUNSET = 3,
-  KEY_TEMPERATURE = 4,
-  KEY_CITYID = 5,
-  KEY_PREV_SUNRISE = 20,
-  KEY_PREV_SUNSET = 21,
-  KEY_NEXT_SUNRISE = 22,
-  KEY_NEXT_SUNSET = 23,
-  KEY_TIME_STAMP = 24,
-  KEY_TEMP_TIME_STAMP = 25
-};
+static int spark_low, spark_high;                   // temperatures at the inner and outer edge of the sparkline
+static HistorySample spark_last;                    // newest sample drawn on the sparkline
+static bool spark_has_last = false;
+static GBitmap *sky_image;
+static SkyBands sky_bands;                          // bands currently rasterized in sky_image
+static bool sky_valid = false;
+static int sky_rasters = 0;                         // times sky_image has been drawn, for the trace
+static SkyInterval twilight[SKY_LEVELS];            // from the sun table; [0] is unused
+static int32_t twilight_inputs[4];                  // day, latitude, longitude and UTC offset they were found for
 
 
 static TextLayer* init_text_layer(GRect location, GColor color, GColor background, const char *res_id, GTextAlignment alignment) {
@@ -100,12 +148,7 @@ static TextLayer* init_text_layer(GRect location, GColor color, GColor backgroun
 static bool time_to_refresh() {
   /* Check the current time with time of last check.  Return
   true if greater than 15 minutes. */
-  time_t time_passed = time(NULL) - time_stamp;
-  if(time_stamp == 0 || time_passed >= TIMEOUT) {
-    return true;
-  } else {
-    return false;
-  }
+  return ephemeris_refresh_due(time(NULL), time_stamp);
 }
 
 
@@ -132,6 +175,7 @@ static void bluetooth_handler(bool connected) {
   bluetooth_connected = connected;
   if (!connected) {
     getting_weather = false;
+    push_mode = false;  // Ask once on reconnect; the reply turns pushing back on.
     bitmap_layer_set_bitmap(noti_layer, no_bluetooth_image);
   } 
   else if (connected) {
@@ -169,11 +213,7 @@ static void reframe_sun_layer(time_t now) {
 
 
 static void assign_rise_or_set_epoch(time_t incoming_epoch, char *motion, time_t now) {
-  /* Given a rise or set time, determine if it should replace either 'next' or 'prev' values.
-  A)   incoming < prev < now < next  Shouldn't happen.  If it does, don't update any times.
-  B)   prev < incoming < now < next  Incoming time in past, but more recent than prev. Update prev time.
-  C)   prev < now < incoming < next  Incoming time is in the future, but sooner than next. Use incoming.
-  D)   prev < now < next < incoming  Incoming time is in the future after next.  Don't update. */
+  /* Offer a rise or set time to the 'prev' and 'next' epochs (see ephemeris_assign_epoch). */
   time_t *prev_epoch;
   time_t *next_epoch;
 
@@ -190,17 +230,8 @@ static void assign_rise_or_set_epoch(time_t incoming_epoch, char *motion, time_t
     return;
   }
 
-  if (difftime(*prev_epoch, incoming_epoch)>0) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: 'incoming_epoch' < 'prev'; not using.");
-  }
-  else if (difftime(incoming_epoch, *prev_epoch)>0 && difftime(now, incoming_epoch)>0) {
-    *prev_epoch = incoming_epoch;
-  } 
-  else if (difftime(incoming_epoch, now)>0 && difftime(*next_epoch, incoming_epoch)>0) {
-    *next_epoch = incoming_epoch;
-  } 
-  else if (difftime(incoming_epoch, *next_epoch)>0) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: 'incoming_epoch' > 'next'; not using.");
+  if (!ephemeris_assign_epoch(now, incoming_epoch, prev_epoch, next_epoch)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: 'incoming_epoch' outside 'prev' to 'next'; not using.");
   }
 }
 
@@ -208,196 +239,121 @@ static void assign_rise_or_set_epoch(time_t incoming_epoch, char *motion, time_t
 static void update_rise_and_set_epochs(time_t now) {
   /* Check to see that 'next' times are still in the future. If not,
   set them to 'prev' and set 'next' to INF. */
-  if (difftime(now, next_sunrise_epoch)>0) {
-    prev_sunrise_epoch = next_sunrise_epoch;
-    next_sunrise_epoch = (time_t) INF;
-  }
-  if (difftime(now, next_sunset_epoch)>0) {
-    prev_sunset_epoch = next_sunset_epoch;
-    next_sunset_epoch = (time_t) INF;
-  }
+  ephemeris_roll_epochs(now, &prev_sunrise_epoch, &next_sunrise_epoch);
+  ephemeris_roll_epochs(now, &prev_sunset_epoch, &next_sunset_epoch);
 }
 
 
-static void daylight_update_proc(Layer *layer, GContext *ctx) {
-  /* Update the daylight path if both epochs are valid.  If not, draw either a line
-  or fill in the face with a solid color. */
-  time_t now = time(NULL);
-  time_t this_sunrise_epoch;
-  time_t this_sunset_epoch;
-
-  // Decided which rise/set epochs to use (prev or next).
-  if (difftime(next_sunrise_epoch, now)<86400) {
-    this_sunrise_epoch = next_sunrise_epoch;
-  } else if (difftime(now, prev_sunrise_epoch)<86400) {
-    this_sunrise_epoch = prev_sunrise_epoch;
-  } else {
-    this_sunrise_epoch = INVALID;
-  }
-  if (difftime(next_sunset_epoch, now)<86400) {
-    this_sunset_epoch = next_sunset_epoch;
-  } else if (difftime(now, prev_sunset_epoch)<86400) {
-    this_sunset_epoch = prev_sunset_epoch;
-  } else {
-    this_sunset_epoch = INVALID;
-  }
+static void select_rise_and_set_epochs(time_t now, time_t *this_sunrise_epoch, time_t *this_sunset_epoch) {
+  /* Decide which rise/set epochs to use (prev or next).  Either is INVALID if
+  neither falls within 24 hours of now. */
+  *this_sunrise_epoch = ephemeris_select_epoch(now, prev_sunrise_epoch, next_sunrise_epoch);
+  *this_sunset_epoch = ephemeris_select_epoch(now, prev_sunset_epoch, next_sunset_epoch);
+}
 
-  /* If we have a valid rise and set within 24 hours, draw
-    both sunrise and sunset, creating a day and night side. */
-  if (this_sunrise_epoch != INVALID && this_sunset_epoch != INVALID) {  
-    GPoint sunrise_point = get_point_from_time(this_sunrise_epoch, CLOCK_RAD);
-    GPoint sunset_point = get_point_from_time(this_sunset_epoch, CLOCK_RAD);
-    
-    // Assumes 00:00 < sunrise < 12:00 and 12:00 < sunset < 24:00 
-    GPathInfo info = {
-      .num_points = 7,
-      .points = (GPoint []) {
-        {CX, CY},                // center
-        sunrise_point,           // sunrise angle (edge of circle)
-        {0, sunrise_point.y},    // left edge
-        {0, 0},                  // topleft
-        {W, 0},                  // top right
-        {W, sunset_point.y},     // right edge
-        sunset_point             // sunset point  (edge of circle)
-      }
-    };
 
-    GPath *new_path_ptr = gpath_create(&info);
-    gpath_move_to(new_path_ptr, GPoint(0, 0));
-    graphics_context_set_fill_color(ctx, GColorWhite);
-    gpath_draw_filled(ctx, new_path_ptr);
-    gpath_destroy(new_path_ptr); // Clear the path from RAM.
-  } 
+static void fill_rise_and_set_from_table(time_t now) {
+  /* When a 'next' epoch is missing, look up yesterday's, today's and tomorrow's
+  rise and set in the sun table, so the face doesn't wait on the phone for
+  them.  The phone's values replace these whenever they arrive. */
+  if (location_missing || timezone_missing) return;
+  if (next_sunrise_epoch != INF && next_sunset_epoch != INF) return;
+  if (difftime(table_retry_time, now) > 0) return;
 
-  /* It is perpetual daylight or nighttime if both rise and set are more than 24h in future. */
-  else if (difftime(next_sunset_epoch, now)>86400 && next_sunset_epoch != INF && difftime(next_sunrise_epoch, now)>86400 && next_sunrise_epoch != INF) { 
-    snprintf(log_buffer, 256, "PEBBLE: 24h day/night. next_rise=%d, next_set=%d, INF=%d", (int) next_sunrise_epoch, (int) next_sunset_epoch, (int) INF);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+  table_horizon = sky_find_epochs(now, latitude, longitude, timezone_offset,
+                                  &prev_sunrise_epoch, &next_sunrise_epoch, &prev_sunset_epoch, &next_sunset_epoch);
 
-    // Perpetual night time.  Don't draw a path.
-    if (difftime(next_sunset_epoch, next_sunrise_epoch)>0) {
-      if (difftime(now, prev_sunset_epoch)<86400) {
-        // Sunset happened within the last 24 hours, draw a line if you wish.
-        // DRAW SUNSET LINE HERE
-      }
-    } 
-
-    // Perpetual day time. Draw a full path.
-    else if (difftime(next_sunrise_epoch, next_sunset_epoch)>0) {
-      GPath *new_path_ptr = gpath_create(&FULL_DAY_PATH_INFO);
-      gpath_move_to(new_path_ptr, GPoint(0, 0));
-      graphics_context_set_fill_color(ctx, GColorWhite);
-      gpath_draw_filled(ctx, new_path_ptr);
-      gpath_destroy(new_path_ptr);
-      if (difftime(now, prev_sunrise_epoch)<86400) {
-        // Sunrise happened within the last 24 hours, draw a line if you wish.
-        // DRAW A SUNRISE LINE HERE
-      }
-    }
-  } 
+  // Polar day or night: nothing to find for a while.
+  if (next_sunrise_epoch == INF || next_sunset_epoch == INF) {
+    table_retry_time = now + TABLE_RETRY;
+  }
+}
 
-  /* It is perpetual nighttime since a recent set means the next set must be after next rise, and 
-  the next rise will not happen for a long time. Don't draw the day path.*/
-  else if (difftime(now, prev_sunset_epoch)<86400 && prev_sunset_epoch != ZERO && difftime(next_sunrise_epoch, now)>86400 && next_sunrise_epoch != INF) {
-    // DRAW SUNSET LINE HERE
-  } 
 
-  /* It is perpetual daytime since a recent rise means the next rise must be after the next set,
-  and the next set will not happen for a long time. Draw full day path.*/
-  else if (difftime(now, prev_sunrise_epoch)<86400 && prev_sunrise_epoch != ZERO && difftime(next_sunset_epoch, now)>86400 && next_sunset_epoch != INF) {
-    GPath *new_path_ptr = gpath_create(&FULL_DAY_PATH_INFO);
-    gpath_move_to(new_path_ptr, GPoint(0, 0));
-    graphics_context_set_fill_color(ctx, GColorWhite);
-    gpath_draw_filled(ctx, new_path_ptr);
-    gpath_destroy(new_path_ptr);
-    // DRAW SUNRISE LINE HERE
-  } 
+static void find_twilight_intervals(time_t now) {
+  /* Look up civil, nautical and astronomical twilight for the local day.
+  These only change with the day, the place or the time zone. */
+  int day = (int)((now + ephemeris_wall_offset(now)) / 86400);     // the local date, days since 1970
+  int offset = (ephemeris_wall_offset(now) - timezone_offset) / 60;  // UTC to local minutes
+  int32_t inputs[4] = { day, latitude, longitude, offset };
+  if (memcmp(inputs, twilight_inputs, sizeof(inputs)) == 0) return;
+  memcpy(twilight_inputs, inputs, sizeof(inputs));
 
-  /* Insufficient information to determine sky.  Draw day path.*/
-  else {
-    GPath *new_path_ptr = gpath_create(&FULL_DAY_PATH_INFO);
-    gpath_move_to(new_path_ptr, GPoint(0, 0));
-    graphics_context_set_fill_color(ctx, GColorWhite);
-    gpath_draw_filled(ctx, new_path_ptr);
-    gpath_destroy(new_path_ptr);
+  sky_find_twilight(day, latitude, longitude, offset, twilight);
+}
+
+
+static void find_sky_bands(time_t now, SkyBands *bands) {
+  /* The horizon comes from the rise and set epochs, or in polar day or night,
+  when there are none, from the sun table; the twilights from the sun table.
+  Without a position nothing is known but the epochs, and sky_nest_bands
+  fills in the rest. */
+  const bool table_missing = location_missing || timezone_missing;
+  sky_find_horizon(now, prev_sunrise_epoch, next_sunrise_epoch, prev_sunset_epoch, next_sunset_epoch,
+                   table_missing ? SKY_UNKNOWN : table_horizon, &bands->above[0]);
+  if (!table_missing) {
+    find_twilight_intervals(now);
+  }
+
+  for (int i = 1; i < SKY_LEVELS; i++) {
+    bands->above[i] = table_missing ? (SkyInterval) { .state = SKY_UNKNOWN } : twilight[i];
   }
+  sky_nest_bands(bands);
+}
+    
+
+static void daylight_update_proc(Layer *layer, GContext *ctx) {
+  /* Draw the sky, rasterizing it again only when the bands have moved.  White
+  pixels light up the white clockface underneath. */
+  SkyBands bands;
+  find_sky_bands(time(NULL), &bands);
+  if (!sky_valid || !sky_bands_equal(&bands, &sky_bands)) {
+    sky_render(sky_image, &bands, GPoint(CLOCK_RAD, CLOCK_RAD));
+    sky_bands = bands;
+    sky_valid = true;
+    sky_rasters++;
+  } 
+  graphics_context_set_compositing_mode(ctx, COMP_W);
+  graphics_draw_bitmap_in_rect(ctx, sky_image, layer_get_bounds(layer));
 }
 
 
 static double calc_moon_phase(time_t now) {
   /* Calculate the current moon phase from 0 to 1.  0=new, 0.25=first quarter, and 0.5=full. */
-  double diff = difftime(now, NEW_MOON) + timezone_offset;
-  double phase = diff / LUNAR_CYCLE;
-  phase = phase - (int)phase;
-  return phase;
+  return ephemeris_moon_phase(now, timezone_offset);
 }
 
 
-static void update_moon_image(time_t now) {
-  /* Determine the image_type and image_rotation to use. Phase must be in range [0,1].
-  Image types:  {0:new, 1:wax_cresc, 2:first_quarter, 3:wax_gibb, 4:full, ..., 7:wan_cresc}
-  Rotations are {0:sun_at_00, 1:sun_at_03, 2:sun_at_06, 3:sun_at_09, ...}  */
-
-  // Determine which image_type to use.
-  double phase = calc_moon_phase(now);
-  int img_type = (int) ((phase + 0.0625) / 0.125);
-  if (img_type == 8) img_type = 0;
-
-  // Determine which image_rotation to use.
-  struct tm *now_cal = localtime(&now);
-  int h = now_cal->tm_hour;
-  int m = now_cal->tm_min;
-  int month = now_cal->tm_mon;
-  int day = now_cal->tm_mday;
-  double hour = h + (m / 60.0);
-  double rotation = hour / 24.0;
-  rotation = rotation - (int)rotation;
-  int img_rotation = (int) ((rotation+0.0625) / 0.125);
-  if (img_rotation == 8) img_rotation = 0;
- 
-  // Easter Egg
-  if (month == 4 && day == 4) {
-    img_type = 8;
-    img_rotation = 0;
-  }
-
+static void set_moon_image(int img_type, int img_rotation) {
+  /* Show the moon image for the given type and rotation (see ephemeris_moon_image). */
   int new_image_index[2] = {img_type, img_rotation};
 
-  // If we need it, load in a new image.
+  // Only move to another cell if the image has changed.
   if (new_image_index[0] != current_image_index[0] || new_image_index[1] != current_image_index[1]) {
     current_image_index[0] = new_image_index[0];
     current_image_index[1] = new_image_index[1];
-    int resource_id_b = MOON_IDS[img_type][img_rotation][0];
-    int resource_id_w = MOON_IDS[img_type][img_rotation][1];
-
-    layer_remove_from_parent(bitmap_layer_get_layer(b_moon_layer));
-    bitmap_layer_destroy(b_moon_layer);
-    gbitmap_destroy(b_moon_image);
-    b_moon_image = gbitmap_create_with_resource(resource_id_b);
-    b_moon_layer = bitmap_layer_create(GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+    GRect cell = GRect(MOON_CELLS[img_type][img_rotation] * MOON_DIAMETER, 0, MOON_DIAMETER, MOON_DIAMETER);
+
+    // Both atlases are loaded, so this only points the bitmaps elsewhere.
+    raster_set_bounds(b_moon_image, cell);
     bitmap_layer_set_bitmap(b_moon_layer, b_moon_image);
-    bitmap_layer_set_background_color(b_moon_layer, GColorClear);
-    bitmap_layer_set_compositing_mode(b_moon_layer, GCompOpAnd);
-    layer_add_child(moon_layer, bitmap_layer_get_layer(b_moon_layer));
-
-    layer_remove_from_parent(bitmap_layer_get_layer(w_moon_layer));
-    bitmap_layer_destroy(w_moon_layer);
-    gbitmap_destroy(w_moon_image);
-    w_moon_image = gbitmap_create_with_resource(resource_id_w);
-    w_moon_layer = bitmap_layer_create(GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+    raster_set_bounds(w_moon_image, cell);
     bitmap_layer_set_bitmap(w_moon_layer, w_moon_image);
-    bitmap_layer_set_background_color(w_moon_layer, GColorClear);
-    bitmap_layer_set_compositing_mode(w_moon_layer, GCompOpOr);
-    layer_add_child(moon_layer, bitmap_layer_get_layer(w_moon_layer));
   }
 }
 
 
-static void reframe_moon_layer(time_t now) {
+static void update_moon_image(time_t now) {
+  int img_type, img_rotation;
+  ephemeris_moon_image(now, calc_moon_phase(now), &img_type, &img_rotation);
+  set_moon_image(img_type, img_rotation);
+}
+
+
+static void reframe_moon_layer(time_t now, double phase) {
   /* Reframe the moon layer to the correct position and make it visible.*/
   const int16_t moonDiameter = layer_get_bounds(moon_layer).size.w;  // replace with definition?
   int moonRingRadius = CLOCK_RAD - 10;
-  double phase = calc_moon_phase(now);
   double seconds_behind = (phase * 24.0 * 3600);
   time_t moontime = (time_t) ((long)now - seconds_behind);
   GPoint moonLocation = get_point_from_time(moontime, moonRingRadius);
@@ -408,108 +364,257 @@ static void reframe_moon_layer(time_t now) {
 }
 
 
-/*  COMMUNICATION WITH PHONE
-    ------------------------  */
-static void get_weather() {
-  if(!getting_weather) {
-    getting_weather = true;
-    bitmap_layer_set_bitmap(noti_layer, refresh_image);
-    time_stamp = time(NULL) - TIMEOUT;  // Reset time_stamp back to interval to avoid simultanious runs of get_weather
-    DictionaryIterator *iter;
-    app_message_outbox_begin(&iter);
-    Tuplet value = TupletCString(KEY_STATUS, "retrieve");
-    dict_write_tuplet(iter, &value);
-    app_message_outbox_send();
+/*  TEMPERATURE SPARKLINE
+    ---------------------  */
+static int spark_radius(int32_t temp) {
+  return SPARK_RAD_MIN + (temp - spark_low) * (SPARK_RAD_MAX - SPARK_RAD_MIN) / (spark_high - spark_low);
+}
+
+
+static void plot_spark_segment(const HistorySample *from, const HistorySample *to) {
+  /* Draw one piece of the curve as a black line on a white halo, so it shows
+  on both day and night.  Samples too far apart are not joined. */
+  GPoint p1 = get_point_from_time(to->time, spark_radius(to->value));
+  GPoint p0 = p1;
+  if (from != NULL && difftime(to->time, from->time) <= SPARK_GAP) {
+    p0 = get_point_from_time(from->time, spark_radius(from->value));
+  }
+  for (int dx = -1; dx <= 1; dx++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      raster_draw_line(w_spark_image, GPoint(p0.x + dx, p0.y + dy), GPoint(p1.x + dx, p1.y + dy), GColorWhite);
     }
+  }
+  raster_draw_line(b_spark_image, p0, p1, GColorBlack);
 }
 
 
-static void out_failed_handler(DictionaryIterator *failed, AppMessageResult reason, void *context) {
-  snprintf(log_buffer, 64, "PEBBLE: Failed to Send: reason %d", (int) reason);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+static void erase_spark_wedge(time_t start, time_t end) {
+  /* Clear the band between two times of day, wiping whatever is left there
+  from the day before.  One radial line per minute leaves no gaps. */
+  for (time_t t = start; t <= end; t += 60) {
+    GPoint inner = get_point_from_time(t, SPARK_RAD_MIN - 2);
+    GPoint outer = get_point_from_time(t, SPARK_RAD_MAX + 2);
+    raster_draw_line(w_spark_image, inner, outer, GColorBlack);
+    raster_draw_line(b_spark_image, inner, outer, GColorWhite);
+  }
 }
 
 
-static void out_sent_handler(DictionaryIterator *sent, void *context) {
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Message sent successfully.");
+static bool find_spark_range(const HistorySample *sample, void *context) {
+  if (sample->kind == HISTORY_TEMPERATURE) {
+    if (sample->value < spark_low) spark_low = sample->value;
+    if (sample->value > spark_high) spark_high = sample->value;
+  }
+  return true;
 }
 
 
-static void in_dropped_handler(AppMessageResult reason, void *context) {
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: App Message Dropped!");
+static bool plot_spark_sample(const HistorySample *sample, void *context) {
+  if (sample->kind == HISTORY_TEMPERATURE) {
+    plot_spark_segment(spark_has_last ? &spark_last : NULL, sample);
+    spark_last = *sample;
+    spark_has_last = true;
+  }
+  return true;
 }
 
 
-static void in_received_handler(DictionaryIterator *message, void *context) {
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: call to in_received_handler");
-  time_t now = time(NULL);
-  char *status = (char*)dict_find(message, KEY_STATUS)->value;
+static void rebuild_sparkline(time_t now) {
+  /* Redraw the whole curve from history, rescaling it to the last day's range. */
+  time_t since = now - 86400 + SPARK_LEAD;
+  raster_fill(w_spark_image, GColorBlack);
+  raster_fill(b_spark_image, GColorWhite);
+  spark_has_last = false;
+
+  spark_low = 1000;
+  spark_high = -1000;
+  history_foreach(since, find_spark_range, NULL);
+  if (spark_low <= spark_high) {
+    // Pad the range so small changes don't force a rebuild.
+    spark_low -= 2;
+    spark_high += 2;
+    if (spark_high - spark_low < 12) {
+      int pad = (12 - (spark_high - spark_low) + 1) / 2;
+      spark_low -= pad;
+      spark_high += pad;
+    }
+    history_foreach(since, plot_spark_sample, NULL);
+  }
 
-  if(strcmp(status, "ready") == 0) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"ready\"");
-    js_ready = true;
-    bitmap_layer_set_bitmap(noti_layer, empty_image);
-    get_weather();
-  } 
+  layer_mark_dirty(bitmap_layer_get_layer(w_spark_layer));
+  layer_mark_dirty(bitmap_layer_get_layer(b_spark_layer));
+}
 
-  else if(strcmp(status, "reporting") == 0) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"reporting\"");
-    getting_weather = false;
-    bitmap_layer_set_bitmap(noti_layer, empty_image);
 
-    // Location
-    int new_cityID = dict_find(message, KEY_CITYID)->value->int32;
-    if (new_cityID != cityID && cityID != -999) {
-      prev_sunrise_epoch = ZERO;
-      next_sunrise_epoch = INF;
-      prev_sunset_epoch = ZERO;
-      next_sunset_epoch = INF;
+static void append_sparkline(const HistorySample *sample) {
+  /* Add a new sample to the curve.  Only the wedge it covers is touched
+  unless the sample falls outside the current scale. */
+  if (!spark_has_last || sample->value < spark_low || sample->value > spark_high ||
+      difftime(sample->time, spark_last.time) > 86400 - SPARK_LEAD) {
+    rebuild_sparkline(sample->time);
+    return;
+  }
+  erase_spark_wedge(spark_last.time + 60, sample->time + SPARK_LEAD);
+  plot_spark_segment(&spark_last, sample);
+  spark_last = *sample;
+
+  layer_mark_dirty(bitmap_layer_get_layer(w_spark_layer));
+  layer_mark_dirty(bitmap_layer_get_layer(b_spark_layer));
+}
+
+
+static void record_temperature(time_t now) {
+  /* Keep at most one temperature per HISTORY_INTERVAL. */
+  HistorySample last;
+  if (history_last(HISTORY_TEMPERATURE, &last) && difftime(now, last.time) < HISTORY_INTERVAL) return;
+  history_add(HISTORY_TEMPERATURE, now, temperature);
+  if (history_last(HISTORY_TEMPERATURE, &last)) append_sparkline(&last);
+}
+
+
+static void record_rise_or_set(HistoryKind kind, time_t now, time_t epoch) {
+  /* Keep a rise or set only when it differs from the one last kept. */
+  HistorySample last;
+  if (history_last(kind, &last) && abs((int)(last.value - epoch)) < 60) return;
+  history_add(kind, now, (int32_t)epoch);
+}
+
+
+/*  DETAIL OVERLAY
+    --------------  */
+static void format_epoch(char *buffer, size_t size, time_t epoch) {
+  /* Write "HH:MM" for a rise/set epoch, or dashes if it is not known. */
+  if (epoch == ZERO || epoch == INF || epoch == INVALID) {
+    snprintf(buffer, size, "--:--");
+  } else {
+    strftime(buffer, size, "%H:%M", localtime(&epoch));
+  }
+}
+
+
+static void detail_background_update_proc(Layer *layer, GContext *ctx) {
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+}
+
+
+static void add_detail_row(DetailRow row) {
+  /* Create one line of the overlay, label and value, and attach it to the
+  overlay layer. */
+  DetailOverlay *d = detail_overlay;
+  d->label_layers[row] = init_text_layer(DETAIL_ROW(row), GColorWhite, GColorClear, FONT_KEY_GOTHIC_18_BOLD, GTextAlignmentLeft);
+  text_layer_set_text(d->label_layers[row], DETAIL_LABELS[row]);
+  layer_add_child(d->detail_layer, (Layer*) d->label_layers[row]);
+  d->value_layers[row] = init_text_layer(DETAIL_ROW(row), GColorWhite, GColorClear, FONT_KEY_GOTHIC_18_BOLD, GTextAlignmentRight);
+  text_layer_set_text(d->value_layers[row], d->values[row]);
+  layer_add_child(d->detail_layer, (Layer*) d->value_layers[row]);
+}
+
+
+static void fill_detail_buffers(time_t now) {
+  /* Format rise/set times, day length, moon illumination and data age. */
+  DetailOverlay *d = detail_overlay;
+  format_epoch(d->values[DETAIL_PREV_SUNRISE], sizeof(d->values[0]), prev_sunrise_epoch);
+  format_epoch(d->values[DETAIL_PREV_SUNSET], sizeof(d->values[0]), prev_sunset_epoch);
+  format_epoch(d->values[DETAIL_NEXT_SUNRISE], sizeof(d->values[0]), next_sunrise_epoch);
+  format_epoch(d->values[DETAIL_NEXT_SUNSET], sizeof(d->values[0]), next_sunset_epoch);
+
+  time_t this_sunrise_epoch, this_sunset_epoch;
+  select_rise_and_set_epochs(now, &this_sunrise_epoch, &this_sunset_epoch);
+  char *day_length_buffer = d->values[DETAIL_DAY_LENGTH];
+  if (this_sunrise_epoch != INVALID && this_sunset_epoch != INVALID) {
+    int day_length = (int) difftime(this_sunset_epoch, this_sunrise_epoch);
+    if (day_length < 0) day_length += 86400;
+    snprintf(day_length_buffer, sizeof(d->values[0]), "%dh %02dm", day_length / 3600, (day_length % 3600) / 60);
+  } else {
+    snprintf(day_length_buffer, sizeof(d->values[0]), "--");
+  }
+
+  char *moon_phase_buffer = d->values[DETAIL_MOON_PHASE];
+  if (!timezone_missing) {
+    // Illuminated fraction is (1 - cos(phase)) / 2.
+    int32_t angle = (int32_t) (calc_moon_phase(now) * TRIG_MAX_ANGLE);
+    int illumination = (int) ((TRIG_MAX_RATIO - cos_lookup(angle)) * 50 / TRIG_MAX_RATIO);
+    snprintf(moon_phase_buffer, sizeof(d->values[0]), "%d%%", illumination);
+  } else {
+    snprintf(moon_phase_buffer, sizeof(d->values[0]), "--");
+  }
+
+  char *data_age_buffer = d->values[DETAIL_DATA_AGE];
+  if (temp_time_stamp != 0) {
+    int age = (int) difftime(now, temp_time_stamp) / 60;
+    if (age < 60) {
+      snprintf(data_age_buffer, sizeof(d->values[0]), "%dm", age);
+    } else {
+      snprintf(data_age_buffer, sizeof(d->values[0]), "%dh %02dm", age / 60, age % 60);
     }
-    cityID = new_cityID;
-    snprintf(log_buffer, 128, "id=%d", cityID);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+  } else {
+    snprintf(data_age_buffer, sizeof(d->values[0]), "none");
+  }
+}
 
-    // Timezone offset and moon
-    timezone_offset = dict_find(message, KEY_TZOFFSET)->value->int32;
-    timezone_missing = false;
-    update_moon_image(now);
-    reframe_moon_layer(now);
 
-    // Temperature
-    temperature = dict_find(message, KEY_TEMPERATURE)->value->int32;
-    snprintf(temp_buffer, sizeof("-123\u00B0"), "%d\u00B0", temperature);
-    text_layer_set_text(temp_text_layer, temp_buffer);
-    temp_time_stamp = time(NULL);
-
-    // Sunrise/set and daylight path
-    int incoming_sunrise = dict_find(message, KEY_SUNRISE)->value->int32;
-    int incoming_sunset = dict_find(message, KEY_SUNSET)->value->int32;
-    assign_rise_or_set_epoch((time_t) incoming_sunrise - timezone_offset, "rise", now);
-    assign_rise_or_set_epoch((time_t) incoming_sunset - timezone_offset, "set", now);
-    update_rise_and_set_epochs(now);
-    layer_mark_dirty(daylight_layer);
+static void hide_detail_overlay(void *data) {
+  /* Tear down the overlay and give all of its memory back. */
+  detail_timer = NULL;
+  if (detail_overlay == NULL) return;
 
-    time_stamp = time(NULL);
-  } 
+  layer_remove_from_parent(detail_overlay->detail_layer);
+  for (int row = 0; row < DETAIL_ROWS; row++) {
+    text_layer_destroy(detail_overlay->label_layers[row]);
+    text_layer_destroy(detail_overlay->value_layers[row]);
+  }
+  layer_destroy(detail_overlay->detail_layer);
+  free(detail_overlay);
+  detail_overlay = NULL;
+}
 
-  else if(strcmp(status, "failed") == 0) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"failed\"");
-    getting_weather = false;
-    bitmap_layer_set_bitmap(noti_layer, error_image);
 
-    timezone_offset = dict_find(message, KEY_TZOFFSET)->value->int32;
-    timezone_missing = false;
-    update_moon_image(now);
-    reframe_moon_layer(now);
+static void show_detail_overlay() {
+  /* Build the overlay on top of the face and schedule its removal. */
+  detail_overlay = malloc(sizeof(DetailOverlay));
+  if (detail_overlay == NULL) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Not enough memory for the detail overlay.");
+    return;
+  }
+  fill_detail_buffers(time(NULL));
 
-    time_stamp = time(NULL) - (TIMEOUT - ERROR_TIMEOUT);
+  Layer *window_layer = window_get_root_layer(window);
+  detail_overlay->detail_layer = layer_create(layer_get_bounds(window_layer));
+  layer_set_update_proc(detail_overlay->detail_layer, detail_background_update_proc);
+  for (int row = 0; row < DETAIL_ROWS; row++) {
+    add_detail_row(row);
   }
+  layer_add_child(window_layer, detail_overlay->detail_layer);
+
+  detail_timer = app_timer_register(DETAIL_TIMEOUT, hide_detail_overlay, NULL);
 }
 
 
+static void tap_handler(AccelAxisType axis, int32_t direction) {
+  /* A tap (or shake) summons the overlay, or keeps it up a little longer. */
+  if (detail_overlay == NULL) {
+    show_detail_overlay();
+  } else if (detail_timer != NULL) {
+    app_timer_reschedule(detail_timer, DETAIL_TIMEOUT);
+  }
+}
+
+
+/*  PERSISTENT STORAGE
+    ------------------  */
+static void set_timezone_offset(int32_t offset) {
+  /* Take the phone's offset from UTC.  Only SDK 2 needs it: there time()
+  is local, while on SDK 3 it is already UTC. */
+#if defined(PBL_SDK_3)
+  timezone_offset = 0;
+#else
+  timezone_offset = offset;
+#endif
+  timezone_missing = false;
+}
+
 
-/*  OTHER
-    -----  */
 static bool data_to_load() {
   return (
     persist_exists(KEY_PREV_SUNRISE) &&
@@ -527,6 +632,7 @@ static bool data_to_load() {
 
 static void save_data() {
   /* Save data to persistent storage if we have it.*/
+  history_save(KEY_HISTORY);
   if(!timezone_missing) {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Saving data to persistent storage.");
     persist_write_int(KEY_PREV_SUNRISE, prev_sunrise_epoch);
@@ -538,6 +644,10 @@ static void save_data() {
     persist_write_int(KEY_TEMPERATURE, temperature);
     persist_write_int(KEY_TEMP_TIME_STAMP, temp_time_stamp);
     persist_write_int(KEY_CITYID, cityID);
+    if (!location_missing) {
+      persist_write_int(KEY_LATITUDE, latitude);
+      persist_write_int(KEY_LONGITUDE, longitude);
+    }
   } else
     APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Some values are empty, not saving.");
 }
@@ -551,70 +661,246 @@ static void load_data() {
     APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Loading data from persistent storage.");
 
     cityID = (int)persist_read_int(KEY_CITYID);
+    if (persist_exists(KEY_LATITUDE) && persist_exists(KEY_LONGITUDE)) {
+      latitude = persist_read_int(KEY_LATITUDE);
+      longitude = persist_read_int(KEY_LONGITUDE);
+      location_missing = false;
+    }
 
-    // Get timezone and update moon.
-    timezone_offset = (int)persist_read_int(KEY_TZOFFSET);
-    timezone_missing = false;
-    update_moon_image(now);
-    reframe_moon_layer(now);
-
+    set_timezone_offset(persist_read_int(KEY_TZOFFSET));
     time_stamp = (time_t)persist_read_int(KEY_TIME_STAMP);
 
     // Update the temperature if less than one hour.
     temp_time_stamp = (time_t)persist_read_int(KEY_TEMP_TIME_STAMP);
     temperature = (int)persist_read_int(KEY_TEMPERATURE);
 
-    // Get rise/set information and update daypath.
+    update_moon_image(now);
+    reframe_moon_layer(now, calc_moon_phase(now));
     prev_sunrise_epoch = (time_t)persist_read_int(KEY_PREV_SUNRISE);
     next_sunrise_epoch = (time_t)persist_read_int(KEY_NEXT_SUNRISE);
     prev_sunset_epoch = (time_t)persist_read_int(KEY_PREV_SUNSET);
     next_sunset_epoch = (time_t)persist_read_int(KEY_NEXT_SUNSET);
     update_rise_and_set_epochs(now);
+    fill_rise_and_set_from_table(now);
     layer_mark_dirty(daylight_layer);
   }
 }
 
 
+/*  COMMUNICATION WITH PHONE
+    ------------------------  */
+static void get_weather() {
+  if(!getting_weather) {
+    getting_weather = true;
+    bitmap_layer_set_bitmap(noti_layer, refresh_image);
+    time_stamp = time(NULL) - TIMEOUT;  // Reset time_stamp back to interval to avoid simultanious runs of get_weather
+    DictionaryIterator *iter;
+    app_message_outbox_begin(&iter);
+    Tuplet value = TupletCString(KEY_STATUS, "retrieve");
+    dict_write_tuplet(iter, &value);
+    app_message_outbox_send();
+    }
+}
+
+
+static void out_failed_handler(DictionaryIterator *failed, AppMessageResult reason, void *context) {
+  snprintf(log_buffer, 64, "PEBBLE: Failed to Send: reason %d", (int) reason);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+}
+
+
+static void out_sent_handler(DictionaryIterator *sent, void *context) {
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Message sent successfully.");
+}
+
+
+static void in_dropped_handler(AppMessageResult reason, void *context) {
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: App Message Dropped!");
+}
+
+
+static void write_trace_state(char *buffer, size_t size) {
+  /* The state a message is meant to change, as key=value pairs. */
+  snprintf(buffer, size, "tz=%d push=%d temp=%d city=%d lat=%d lon=%d prev_rise=%d next_rise=%d prev_set=%d next_set=%d sky=%d",
+    timezone_offset, (int) push_mode, temperature, cityID, (int) latitude, (int) longitude,
+    (int) prev_sunrise_epoch, (int) next_sunrise_epoch, (int) prev_sunset_epoch, (int) next_sunset_epoch, sky_rasters);
+}
+
+
+static void trace_state(time_t now) {
+  /* Log the state after a message, for tools/replay to check its own against. */
+  char state[192];
+  write_trace_state(state, sizeof(state));
+  snprintf(log_buffer, 256, "TRACE = %d %s", (int) now, state);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+}
+
+
+static void in_received_handler(DictionaryIterator *message, void *context) {
+  /* Apply a message from the phone.  Any key can be missing from a message;
+  whatever is missing is left as it was. */
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: call to in_received_handler");
+  time_t now = time(NULL);
+  Tuple *status_tuple = dict_find(message, KEY_STATUS);
+  if (!status_tuple || status_tuple->type != TUPLE_CSTRING) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Message without a status, ignored.");
+    return;
+  }
+  char *status = status_tuple->value->cstring;
+  Tuple *tz_tuple = dict_find(message, KEY_TZOFFSET);
+  Tuple *push_tuple = dict_find(message, KEY_PUSH);
+  push_mode = push_tuple && push_tuple->value->int32;
+
+  if(strcmp(status, "ready") == 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"ready\"");
+    js_ready = true;
+    bitmap_layer_set_bitmap(noti_layer, empty_image);
+    if (!push_mode) get_weather();
+  } 
+
+  else if(strcmp(status, "reporting") == 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"reporting\"");
+    getting_weather = false;
+    bitmap_layer_set_bitmap(noti_layer, empty_image);
+
+    // Location
+    Tuple *city_tuple = dict_find(message, KEY_CITYID);
+    if (city_tuple) {
+      int new_cityID = city_tuple->value->int32;
+      if (new_cityID != cityID && cityID != -999) {
+        prev_sunrise_epoch = ZERO;
+        next_sunrise_epoch = INF;
+        prev_sunset_epoch = ZERO;
+        next_sunset_epoch = INF;
+      }
+      cityID = new_cityID;
+      snprintf(log_buffer, 128, "id=%d", cityID);
+      APP_LOG(APP_LOG_LEVEL_DEBUG, log_buffer);
+    }
+
+    Tuple *latitude_tuple = dict_find(message, KEY_LATITUDE);
+    Tuple *longitude_tuple = dict_find(message, KEY_LONGITUDE);
+    if (latitude_tuple && longitude_tuple) {
+      latitude = latitude_tuple->value->int32;
+      longitude = longitude_tuple->value->int32;
+      location_missing = false;
+      table_retry_time = 0;
+    }
+
+    // Timezone offset and moon
+    if (tz_tuple) set_timezone_offset(tz_tuple->value->int32);
+    if (!timezone_missing) {
+      update_moon_image(now);
+      reframe_moon_layer(now, calc_moon_phase(now));
+    }
+
+    // Temperature
+    Tuple *temperature_tuple = dict_find(message, KEY_TEMPERATURE);
+    if (temperature_tuple) {
+      temperature = temperature_tuple->value->int32;
+      snprintf(temp_buffer, sizeof("-123\u00B0"), "%d\u00B0", temperature);
+      glyph_text_set_text(temp_text, temp_buffer);
+      temp_time_stamp = time(NULL);
+      record_temperature(now);
+    }
+
+    // Sunrise/set and daylight path.  They are in UTC, so they need the offset.
+    Tuple *sunrise_tuple = dict_find(message, KEY_SUNRISE);
+    Tuple *sunset_tuple = dict_find(message, KEY_SUNSET);
+    if (sunrise_tuple && sunset_tuple && !timezone_missing) {
+      int incoming_sunrise = sunrise_tuple->value->int32;
+      int incoming_sunset = sunset_tuple->value->int32;
+      assign_rise_or_set_epoch((time_t) incoming_sunrise - timezone_offset, "rise", now);
+      assign_rise_or_set_epoch((time_t) incoming_sunset - timezone_offset, "set", now);
+      record_rise_or_set(HISTORY_SUNRISE, now, (time_t) incoming_sunrise - timezone_offset);
+      record_rise_or_set(HISTORY_SUNSET, now, (time_t) incoming_sunset - timezone_offset);
+    }
+    update_rise_and_set_epochs(now);
+    layer_mark_dirty(daylight_layer);
+
+    time_stamp = time(NULL);
+  } 
+
+  else if(strcmp(status, "failed") == 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Recieved status \"failed\"");
+    getting_weather = false;
+    bitmap_layer_set_bitmap(noti_layer, error_image);
+
+    if (tz_tuple) set_timezone_offset(tz_tuple->value->int32);
+    if (!timezone_missing) {
+      update_moon_image(now);
+      reframe_moon_layer(now, calc_moon_phase(now));
+    }
+
+    time_stamp = time(NULL) - (TIMEOUT - ERROR_TIMEOUT);
+  }
+
+  if (TRACE_MODE) trace_state(now);
+}
+
+
+
+/*  OTHER
+    -----  */
 static void minute_tick_handler(struct tm *tick_time, TimeUnits units_changed) {
   /* Each minute: update clock, move the sun, check weather (if time to), 
   update moon, update temp, update epochs, redraw day path. */
   APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Tick");
   time_t now = time(NULL);
   strftime(time_buffer, sizeof("00:00"), "%H:%M", tick_time);
-  text_layer_set_text(time_text_layer, time_buffer);
+  glyph_text_set_text(time_text, time_buffer);
   strftime(date_buffer, sizeof("00-00"), "%m-%d", tick_time);
-  text_layer_set_text(date_text_layer, date_buffer);
+  glyph_text_set_text(date_text, date_buffer);
 
   reframe_sun_layer(now);
 
-  if (time_to_refresh() && js_ready) {
+  // While the phone is pushing there is nothing to ask for, but if it goes
+  // quiet for longer than it promised, go back to asking.
+  if (push_mode && difftime(now, time_stamp) > PUSH_MAX_AGE) push_mode = false;
+  if (time_to_refresh() && js_ready && !push_mode) {
     get_weather();
   }
   
-  if (!timezone_missing) {
-    update_moon_image(now);
-    reframe_moon_layer(now);
-  } else {
+  if (timezone_missing) {
     layer_set_hidden(moon_layer, true);
+  } else {
+    update_moon_image(now);
+    reframe_moon_layer(now, calc_moon_phase(now));
   }
 
-  if (difftime(now, temp_time_stamp) > 3600) temperature = -999;
+  if (difftime(now, temp_time_stamp) > (push_mode ? PUSH_MAX_AGE : TEMP_MAX_AGE)) temperature = -999;
   if (temperature == -999) {
     snprintf(temp_buffer, sizeof("-123\u00B0"), "--\u00B0");
   } else {
     snprintf(temp_buffer, sizeof("-123\u00B0"), "%d\u00B0", temperature);
   }
-  text_layer_set_text(temp_text_layer, temp_buffer);  
+  glyph_text_set_text(temp_text, temp_buffer);
 
   update_rise_and_set_epochs(now);
+  fill_rise_and_set_from_table(now);
   layer_mark_dirty(daylight_layer);
 }
 
 
+static void glyph_render_update_proc(Layer *layer, GContext *ctx) {
+  /* On the first frame, draw the digits in the system fonts the face has
+  always used and keep them in the atlases; the face paints over this. */
+  glyph_atlas_render(time_atlas, layer, ctx);
+  glyph_atlas_render(small_atlas, layer, ctx);
+}
+
+
 static void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_bounds(window_layer);
   
+  // Create the digit atlases, drawn underneath everything.
+  time_atlas = glyph_atlas_create(fonts_get_system_font(FONT_KEY_DROID_SERIF_28_BOLD), TIME_RECT.size.h, false);
+  small_atlas = glyph_atlas_create(fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD), DATE_RECT.size.h, true);
+  glyph_render_layer = layer_create(bounds);
+  layer_set_update_proc(glyph_render_layer, glyph_render_update_proc);
+  layer_add_child(window_layer, glyph_render_layer);
+
   // Create background clock including the daylight path.
   background_layer = layer_create(bounds);
   layer_add_child(window_layer, background_layer);
@@ -626,7 +912,15 @@ static void window_load(Window *window) {
   bitmap_layer_set_compositing_mode(w_clockface_layer, GCompOpAssign);
   layer_add_child(background_layer, bitmap_layer_get_layer(w_clockface_layer));
 
-  daylight_layer = layer_create(bounds);
+  // The sky only needs to cover the dial; the face masks everything around it.
+  GRect dial = GRect(CX - CLOCK_RAD, CY - CLOCK_RAD, 2 * CLOCK_RAD, 2 * CLOCK_RAD);
+#if defined(PBL_COLOR)
+  sky_image = raster_create_color(dial.size);
+#else
+  sky_image = raster_create(dial.size);
+#endif
+  sky_valid = false;
+  daylight_layer = layer_create(dial);
   layer_set_update_proc(daylight_layer, daylight_update_proc);
   layer_add_child(background_layer, daylight_layer);
 
@@ -634,17 +928,32 @@ static void window_load(Window *window) {
   b_clockface_layer = bitmap_layer_create(bounds);
   bitmap_layer_set_bitmap(b_clockface_layer, b_clockface_image);
   bitmap_layer_set_background_color(b_clockface_layer, GColorClear);
-  bitmap_layer_set_compositing_mode(b_clockface_layer, GCompOpAnd);
+  bitmap_layer_set_compositing_mode(b_clockface_layer, COMP_B);
   layer_add_child(background_layer, bitmap_layer_get_layer(b_clockface_layer));
 
-  // Create the date text layer
-  date_text_layer = init_text_layer(GRect(0, 141, 50, 24), GColorWhite, GColorClear, FONT_KEY_GOTHIC_24_BOLD, GTextAlignmentLeft);
-  text_layer_set_text(date_text_layer, "00-00");
-  layer_add_child(window_layer, (Layer*) date_text_layer);
+  // Create the temperature sparkline, a white halo under a black line.  The
+  // halo's black pixels and the line's white ones are left out.
+  w_spark_image = raster_create_mask(bounds.size, GColorClear, GColorWhite);
+  w_spark_layer = bitmap_layer_create(bounds);
+  bitmap_layer_set_bitmap(w_spark_layer, w_spark_image);
+  bitmap_layer_set_background_color(w_spark_layer, GColorClear);
+  bitmap_layer_set_compositing_mode(w_spark_layer, COMP_W);
+  layer_add_child(background_layer, bitmap_layer_get_layer(w_spark_layer));
   
-  // Create the temperature text layer
-  temp_text_layer = init_text_layer(GRect(99, -3, 45, 24), GColorWhite, GColorClear, FONT_KEY_GOTHIC_24_BOLD, GTextAlignmentRight);
-  layer_add_child(window_layer, (Layer*) temp_text_layer);
+  b_spark_image = raster_create_mask(bounds.size, GColorBlack, GColorClear);
+  b_spark_layer = bitmap_layer_create(bounds);
+  bitmap_layer_set_bitmap(b_spark_layer, b_spark_image);
+  bitmap_layer_set_background_color(b_spark_layer, GColorClear);
+  bitmap_layer_set_compositing_mode(b_spark_layer, COMP_B);
+  layer_add_child(background_layer, bitmap_layer_get_layer(b_spark_layer));
+
+  // Create the date and temperature, white digits from the small atlas.
+  date_text = glyph_text_create(DATE_RECT, small_atlas, GTextAlignmentLeft, COMP_W, GColorClear);
+  glyph_text_set_text(date_text, "00-00");
+  layer_add_child(window_layer, glyph_text_get_layer(date_text));
+
+  temp_text = glyph_text_create(TEMP_RECT, small_atlas, GTextAlignmentRight, COMP_W, GColorClear);
+  layer_add_child(window_layer, glyph_text_get_layer(temp_text));
 
   // Create the notification layer.
   refresh_image = gbitmap_create_with_resource(RESOURCE_ID_REFRESH);
@@ -654,7 +963,7 @@ static void window_load(Window *window) {
   noti_layer = bitmap_layer_create(layer_get_frame(window_layer));
   bitmap_layer_set_background_color(noti_layer, GColorClear);
   layer_add_child(window_layer, bitmap_layer_get_layer(noti_layer));
-  layer_set_frame(bitmap_layer_get_layer(noti_layer), GRect(4, 4, NOTI_W, NOTI_H));
+  layer_set_frame(bitmap_layer_get_layer(noti_layer), GRect(NOTI_ORIGIN.x, NOTI_ORIGIN.y, NOTI_W, NOTI_H));
   layer_set_bounds(bitmap_layer_get_layer(noti_layer), GRect(0, 0, NOTI_W, NOTI_H));
   bluetooth_handler(bluetooth_connection_service_peek());
 
@@ -669,7 +978,7 @@ static void window_load(Window *window) {
   battery_layer = bitmap_layer_create(layer_get_frame(window_layer));
   bitmap_layer_set_background_color(battery_layer, GColorClear);
   layer_add_child(window_layer, bitmap_layer_get_layer(battery_layer));
-  layer_set_frame(bitmap_layer_get_layer(battery_layer), GRect(118, 152, BATT_W, BATT_H));
+  layer_set_frame(bitmap_layer_get_layer(battery_layer), GRect(BATT_ORIGIN.x, BATT_ORIGIN.y, BATT_W, BATT_H));
   layer_set_bounds(bitmap_layer_get_layer(battery_layer), GRect(0, 0, BATT_W, BATT_H));
   battery_handler(battery_state_service_peek());
   
@@ -682,14 +991,14 @@ static void window_load(Window *window) {
   b_sun_layer = bitmap_layer_create(GRect(0, 0, SUN_DIAMETER, SUN_DIAMETER));
   bitmap_layer_set_bitmap(b_sun_layer, b_sun_image);
   bitmap_layer_set_background_color(b_sun_layer, GColorClear);
-  bitmap_layer_set_compositing_mode(b_sun_layer, GCompOpAnd);
+  bitmap_layer_set_compositing_mode(b_sun_layer, COMP_B);
   layer_add_child(sun_layer, bitmap_layer_get_layer(b_sun_layer));
 
   w_sun_image = gbitmap_create_with_resource(RESOURCE_ID_SUN_W);
   w_sun_layer = bitmap_layer_create(GRect(0, 0, SUN_DIAMETER, SUN_DIAMETER));
   bitmap_layer_set_bitmap(w_sun_layer, w_sun_image);
   bitmap_layer_set_background_color(w_sun_layer, GColorClear);
-  bitmap_layer_set_compositing_mode(w_sun_layer, GCompOpOr);
+  bitmap_layer_set_compositing_mode(w_sun_layer, COMP_W);
   layer_add_child(sun_layer, bitmap_layer_get_layer(w_sun_layer));
 
   // Create the moon layer
@@ -698,10 +1007,26 @@ static void window_load(Window *window) {
   layer_set_hidden(moon_layer, true);
   layer_add_child(window_layer, moon_layer);
 
-  // Create the time text layer.
-  time_text_layer = init_text_layer(GRect(30, 35, 84, 28), GColorBlack, GColorWhite, FONT_KEY_DROID_SERIF_28_BOLD, GTextAlignmentCenter);
-  text_layer_set_text(time_text_layer, "N/A");
-  layer_add_child(background_layer, (Layer*) time_text_layer);
+  b_moons_image = gbitmap_create_with_resource(RESOURCE_ID_MOONS_B);
+  b_moon_image = gbitmap_create_as_sub_bitmap(b_moons_image, GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+  b_moon_layer = bitmap_layer_create(GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+  bitmap_layer_set_bitmap(b_moon_layer, b_moon_image);
+  bitmap_layer_set_background_color(b_moon_layer, GColorClear);
+  bitmap_layer_set_compositing_mode(b_moon_layer, COMP_B);
+  layer_add_child(moon_layer, bitmap_layer_get_layer(b_moon_layer));
+
+  w_moons_image = gbitmap_create_with_resource(RESOURCE_ID_MOONS_W);
+  w_moon_image = gbitmap_create_as_sub_bitmap(w_moons_image, GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+  w_moon_layer = bitmap_layer_create(GRect(0, 0, MOON_DIAMETER, MOON_DIAMETER));
+  bitmap_layer_set_bitmap(w_moon_layer, w_moon_image);
+  bitmap_layer_set_background_color(w_moon_layer, GColorClear);
+  bitmap_layer_set_compositing_mode(w_moon_layer, COMP_W);
+  layer_add_child(moon_layer, bitmap_layer_get_layer(w_moon_layer));
+
+  // Create the time, black digits on white.
+  time_text = glyph_text_create(TIME_RECT, time_atlas, GTextAlignmentCenter, COMP_B, GColorWhite);
+  glyph_text_set_text(time_text, "--:--");
+  layer_add_child(background_layer, glyph_text_get_layer(time_text));
 
   // Initialize times
   prev_sunrise_epoch = ZERO;
@@ -711,6 +1036,8 @@ static void window_load(Window *window) {
 
   // Load data from persistent storage
   load_data();
+  history_load(KEY_HISTORY);
+  rebuild_sparkline(time(NULL));
 
   // Execute the minute handler on window load.
   time_t now = time(NULL);
@@ -723,18 +1050,29 @@ static void window_unload(Window *window) {
   // Save data to persistent storage
   save_data();
 
-  // Destroy TextLayers.
-  text_layer_destroy(time_text_layer);
-  text_layer_destroy(date_text_layer);
-  text_layer_destroy(temp_text_layer);
+  // Drop the detail overlay if it is still up.
+  if (detail_timer != NULL) app_timer_cancel(detail_timer);
+  hide_detail_overlay(NULL);
+
+  // Destroy the digits.
+  glyph_text_destroy(time_text);
+  glyph_text_destroy(date_text);
+  glyph_text_destroy(temp_text);
+  glyph_atlas_destroy(time_atlas);
+  glyph_atlas_destroy(small_atlas);
 
   // Destroy GBitmaps.
   gbitmap_destroy(b_sun_image);
   gbitmap_destroy(w_sun_image);
   gbitmap_destroy(b_moon_image);
   gbitmap_destroy(w_moon_image);
+  gbitmap_destroy(b_moons_image);
+  gbitmap_destroy(w_moons_image);
   gbitmap_destroy(b_clockface_image);
   gbitmap_destroy(w_clockface_image);
+  gbitmap_destroy(b_spark_image);
+  gbitmap_destroy(w_spark_image);
+  gbitmap_destroy(sky_image);
   gbitmap_destroy(refresh_image);
   gbitmap_destroy(error_image);
   gbitmap_destroy(empty_image);
@@ -754,6 +1092,8 @@ static void window_unload(Window *window) {
   bitmap_layer_destroy(w_moon_layer);
   bitmap_layer_destroy(b_clockface_layer);
   bitmap_layer_destroy(w_clockface_layer);
+  bitmap_layer_destroy(b_spark_layer);
+  bitmap_layer_destroy(w_spark_layer);
   bitmap_layer_destroy(noti_layer);
   bitmap_layer_destroy(battery_layer);
 
@@ -762,6 +1102,7 @@ static void window_unload(Window *window) {
   layer_destroy(moon_layer);
   layer_destroy(background_layer);
   layer_destroy(daylight_layer);
+  layer_destroy(glyph_render_layer);
 }
 
 
@@ -780,10 +1121,11 @@ static void init(void) {
   app_message_register_outbox_sent(out_sent_handler);
   app_message_open(512, 512);  // Large input and output buffer sizes
 
-  // Subscribe to 'minute' events and 'bluetooth' events.
+  // Subscribe to 'minute', 'bluetooth', 'battery' and 'tap' events.
   tick_timer_service_subscribe(MINUTE_UNIT, (TickHandler) minute_tick_handler);
   bluetooth_connection_service_subscribe(bluetooth_handler);
   battery_state_service_subscribe(battery_handler);
+  accel_tap_service_subscribe(tap_handler);
 
   window_stack_push(window, true);
 }
@@ -794,6 +1136,7 @@ static void deinit(void) {
   tick_timer_service_unsubscribe();
   bluetooth_connection_service_unsubscribe();
   battery_state_service_unsubscribe();
+  accel_tap_service_unsubscribe();
 }
 
 
@@ -801,4 +1144,5 @@ int main(void) {
   init();
   app_event_loop();
   deinit();
+  return 0;
 }
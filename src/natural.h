@@ -1,19 +1,57 @@
-#define CX 72
-#define CY 84
+/* Geometry and compositing are fixed at compile time for each platform the
+wscript builds (the SDK defines PBL_ROUND and PBL_COLOR per platform), so
+no drawing code has to branch on the screen at run time. */
+
+#if defined(PBL_ROUND)
+#define W 180
+#define H 180
+#define CX 90
+#define CY 90
+#define CLOCK_RAD 84
+#define TIME_RECT GRect(48, 41, 84, 28)
+#define DATE_RECT GRect(32, 144, 50, 24)
+#define TEMP_RECT GRect(92, 12, 45, 24)
+#define NOTI_ORIGIN GPoint(43, 16)
+#define BATT_ORIGIN GPoint(122, 152)
+#define DETAIL_HALF(row) (56 + 8 * (3 - abs((row) - 3)))   // rows narrow toward the top and bottom of the dial
+#define DETAIL_ROW(row) GRect(CX - DETAIL_HALF(row), 17 + ((row) * 21), 2 * DETAIL_HALF(row), 21)
+#else
 #define W 144
 #define H 168
+#define CX 72
+#define CY 84
 #define CLOCK_RAD 72
+#define TIME_RECT GRect(30, 35, 84, 28)
+#define DATE_RECT GRect(0, 141, 50, 24)
+#define TEMP_RECT GRect(99, -3, 45, 24)
+#define NOTI_ORIGIN GPoint(4, 4)
+#define BATT_ORIGIN GPoint(118, 152)
+#define DETAIL_ROW(row) GRect(6, 2 + ((row) * 23), W - 12, 23)
+#endif
+
 #define SUN_DIAMETER 29
 #define MOON_DIAMETER 21
 #define NOTI_W 20
 #define NOTI_H 20
 #define BATT_W 20
 #define BATT_H 8
+#define SPARK_RAD_MIN (CLOCK_RAD - 24)
+#define SPARK_RAD_MAX (CLOCK_RAD - 8)
 
-const GPathInfo FULL_DAY_PATH_INFO = {
-  .num_points = 4,
-  .points = (GPoint []) { {0, 0}, {W, 0}, {W, H}, {0, H} }
-};
+/* Every sprite is a pair of masks: b_* darkens what is under it and w_*
+lightens it.  On 1-bit screens that is And and Or.  Color screens load alpha
+variants of the same images (see tools/platform_images.py) and just Set
+them; the sparkline, drawn at run time, gets the same from its masks'
+palettes (see raster.h).  Color screens still draw two layers per sprite,
+in black and white: the sky (sky.h) is the only thing drawn in 8-bit
+color. */
+#if defined(PBL_COLOR)
+#define COMP_B GCompOpSet
+#define COMP_W GCompOpSet
+#else
+#define COMP_B GCompOpAnd
+#define COMP_W GCompOpOr
+#endif
 
 /*
 image_types:
@@ -37,95 +75,28 @@ image_rotations:
   7 sun at 21
 */
 
-const int MOON_IDS[9][9][2] = {          // [phase][rotation][color]
-  {
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W},
-    {RESOURCE_ID_NEW_B, RESOURCE_ID_NEW_W}
-  },
-  {
-    {RESOURCE_ID_CRESCENT_0_B, RESOURCE_ID_CRESCENT_0_W},
-    {RESOURCE_ID_CRESCENT_1_B, RESOURCE_ID_CRESCENT_1_W},
-    {RESOURCE_ID_CRESCENT_2_B, RESOURCE_ID_CRESCENT_2_W},
-    {RESOURCE_ID_CRESCENT_3_B, RESOURCE_ID_CRESCENT_3_W},
-    {RESOURCE_ID_CRESCENT_4_B, RESOURCE_ID_CRESCENT_4_W},
-    {RESOURCE_ID_CRESCENT_5_B, RESOURCE_ID_CRESCENT_5_W},
-    {RESOURCE_ID_CRESCENT_6_B, RESOURCE_ID_CRESCENT_6_W},
-    {RESOURCE_ID_CRESCENT_7_B, RESOURCE_ID_CRESCENT_7_W}
-  },
-  {
-    {RESOURCE_ID_QUARTER_0_B, RESOURCE_ID_QUARTER_0_W},
-    {RESOURCE_ID_QUARTER_1_B, RESOURCE_ID_QUARTER_1_W},
-    {RESOURCE_ID_QUARTER_2_B, RESOURCE_ID_QUARTER_2_W},
-    {RESOURCE_ID_QUARTER_3_B, RESOURCE_ID_QUARTER_3_W},
-    {RESOURCE_ID_QUARTER_4_B, RESOURCE_ID_QUARTER_4_W},
-    {RESOURCE_ID_QUARTER_5_B, RESOURCE_ID_QUARTER_5_W},
-    {RESOURCE_ID_QUARTER_6_B, RESOURCE_ID_QUARTER_6_W},
-    {RESOURCE_ID_QUARTER_7_B, RESOURCE_ID_QUARTER_7_W}
-  },
-  {
-    {RESOURCE_ID_GIBBOUS_0_B, RESOURCE_ID_GIBBOUS_0_W},
-    {RESOURCE_ID_GIBBOUS_1_B, RESOURCE_ID_GIBBOUS_1_W},
-    {RESOURCE_ID_GIBBOUS_2_B, RESOURCE_ID_GIBBOUS_2_W},
-    {RESOURCE_ID_GIBBOUS_3_B, RESOURCE_ID_GIBBOUS_3_W},
-    {RESOURCE_ID_GIBBOUS_4_B, RESOURCE_ID_GIBBOUS_4_W},
-    {RESOURCE_ID_GIBBOUS_5_B, RESOURCE_ID_GIBBOUS_5_W},
-    {RESOURCE_ID_GIBBOUS_6_B, RESOURCE_ID_GIBBOUS_6_W},
-    {RESOURCE_ID_GIBBOUS_7_B, RESOURCE_ID_GIBBOUS_7_W}
-  },
-  {
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W},
-    {RESOURCE_ID_FULL_B, RESOURCE_ID_FULL_W}
-  },
-  {
-    {RESOURCE_ID_GIBBOUS_2_B, RESOURCE_ID_GIBBOUS_2_W},
-    {RESOURCE_ID_GIBBOUS_3_B, RESOURCE_ID_GIBBOUS_3_W},
-    {RESOURCE_ID_GIBBOUS_4_B, RESOURCE_ID_GIBBOUS_4_W},
-    {RESOURCE_ID_GIBBOUS_5_B, RESOURCE_ID_GIBBOUS_5_W},
-    {RESOURCE_ID_GIBBOUS_6_B, RESOURCE_ID_GIBBOUS_6_W},
-    {RESOURCE_ID_GIBBOUS_7_B, RESOURCE_ID_GIBBOUS_7_W},
-    {RESOURCE_ID_GIBBOUS_0_B, RESOURCE_ID_GIBBOUS_0_W},
-    {RESOURCE_ID_GIBBOUS_1_B, RESOURCE_ID_GIBBOUS_1_W}
-  },
-  {
-    {RESOURCE_ID_QUARTER_0_B, RESOURCE_ID_QUARTER_0_W},
-    {RESOURCE_ID_QUARTER_1_B, RESOURCE_ID_QUARTER_1_W},
-    {RESOURCE_ID_QUARTER_2_B, RESOURCE_ID_QUARTER_2_W},
-    {RESOURCE_ID_QUARTER_3_B, RESOURCE_ID_QUARTER_3_W},
-    {RESOURCE_ID_QUARTER_4_B, RESOURCE_ID_QUARTER_4_W},
-    {RESOURCE_ID_QUARTER_5_B, RESOURCE_ID_QUARTER_5_W},
-    {RESOURCE_ID_QUARTER_6_B, RESOURCE_ID_QUARTER_6_W},
-    {RESOURCE_ID_QUARTER_7_B, RESOURCE_ID_QUARTER_7_W}
-  },
-  {
-    {RESOURCE_ID_CRESCENT_6_B, RESOURCE_ID_CRESCENT_6_W},
-    {RESOURCE_ID_CRESCENT_7_B, RESOURCE_ID_CRESCENT_7_W},
-    {RESOURCE_ID_CRESCENT_0_B, RESOURCE_ID_CRESCENT_0_W},
-    {RESOURCE_ID_CRESCENT_1_B, RESOURCE_ID_CRESCENT_1_W},
-    {RESOURCE_ID_CRESCENT_2_B, RESOURCE_ID_CRESCENT_2_W},
-    {RESOURCE_ID_CRESCENT_3_B, RESOURCE_ID_CRESCENT_3_W},
-    {RESOURCE_ID_CRESCENT_4_B, RESOURCE_ID_CRESCENT_4_W},
-    {RESOURCE_ID_CRESCENT_5_B, RESOURCE_ID_CRESCENT_5_W}
-  },
-  {
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W},
-    {RESOURCE_ID_DS_B, RESOURCE_ID_DS_W}
-  }
-};
\ No newline at end of file
+// Cells of the moon atlases made by tools/moon_atlas.py, in its order.
+#define MOON_NEW 0
+#define MOON_FULL 1
+#define MOON_CRESCENT(r) (2 + (r))
+#define MOON_QUARTER(r) (10 + (r))
+#define MOON_GIBBOUS(r) (18 + (r))
+#define MOON_DS 26
+
+const uint8_t MOON_CELLS[9][8] = {       // [phase][rotation]
+  {MOON_NEW, MOON_NEW, MOON_NEW, MOON_NEW, MOON_NEW, MOON_NEW, MOON_NEW, MOON_NEW},
+  {MOON_CRESCENT(0), MOON_CRESCENT(1), MOON_CRESCENT(2), MOON_CRESCENT(3),
+   MOON_CRESCENT(4), MOON_CRESCENT(5), MOON_CRESCENT(6), MOON_CRESCENT(7)},
+  {MOON_QUARTER(0), MOON_QUARTER(1), MOON_QUARTER(2), MOON_QUARTER(3),
+   MOON_QUARTER(4), MOON_QUARTER(5), MOON_QUARTER(6), MOON_QUARTER(7)},
+  {MOON_GIBBOUS(0), MOON_GIBBOUS(1), MOON_GIBBOUS(2), MOON_GIBBOUS(3),
+   MOON_GIBBOUS(4), MOON_GIBBOUS(5), MOON_GIBBOUS(6), MOON_GIBBOUS(7)},
+  {MOON_FULL, MOON_FULL, MOON_FULL, MOON_FULL, MOON_FULL, MOON_FULL, MOON_FULL, MOON_FULL},
+  {MOON_GIBBOUS(2), MOON_GIBBOUS(3), MOON_GIBBOUS(4), MOON_GIBBOUS(5),
+   MOON_GIBBOUS(6), MOON_GIBBOUS(7), MOON_GIBBOUS(0), MOON_GIBBOUS(1)},
+  {MOON_QUARTER(0), MOON_QUARTER(1), MOON_QUARTER(2), MOON_QUARTER(3),
+   MOON_QUARTER(4), MOON_QUARTER(5), MOON_QUARTER(6), MOON_QUARTER(7)},
+  {MOON_CRESCENT(6), MOON_CRESCENT(7), MOON_CRESCENT(0), MOON_CRESCENT(1),
+   MOON_CRESCENT(2), MOON_CRESCENT(3), MOON_CRESCENT(4), MOON_CRESCENT(5)},
+  {MOON_DS, MOON_DS, MOON_DS, MOON_DS, MOON_DS, MOON_DS, MOON_DS, MOON_DS}
+};
@@ -0,0 +1,136 @@
+#include <pebble.h>
+#include "raster.h"
+
+#if defined(PBL_SDK_3)
+#define DATA(bitmap) ((uint8_t*)gbitmap_get_data(bitmap))
+#define ROW_BYTES(bitmap) gbitmap_get_bytes_per_row(bitmap)
+#define SIZE(bitmap) gbitmap_get_bounds(bitmap).size
+#define IS_WHITE(color) gcolor_equal(color, GColorWhite)
+#else
+#define DATA(bitmap) ((uint8_t*)(bitmap)->addr)
+#define ROW_BYTES(bitmap) ((bitmap)->row_size_bytes)
+#define SIZE(bitmap) ((bitmap)->bounds.size)
+#define IS_WHITE(color) ((color) == GColorWhite)
+#endif
+
+
+GBitmap* raster_create(GSize size) {
+#if defined(PBL_SDK_3)
+  return gbitmap_create_blank(size, GBitmapFormat1Bit);
+#else
+  return gbitmap_create_blank(size);
+#endif
+}
+
+
+GBitmap* raster_create_mask(GSize size, GColor black, GColor white) {
+#if defined(PBL_COLOR)
+  GColor *palette = malloc(2 * sizeof(GColor));
+  if (!palette) return NULL;
+  palette[0] = black;
+  palette[1] = white;
+  return gbitmap_create_blank_with_palette(size, GBitmapFormat1BitPalette, palette, true);
+#else
+  return raster_create(size);
+#endif
+}
+
+
+#if defined(PBL_COLOR)
+GBitmap* raster_create_color(GSize size) {
+  return gbitmap_create_blank(size, GBitmapFormat8Bit);
+}
+#endif
+
+
+GSize raster_get_size(GBitmap *bitmap) {
+  return SIZE(bitmap);
+}
+
+
+void raster_set_bounds(GBitmap *bitmap, GRect bounds) {
+#if defined(PBL_SDK_3)
+  gbitmap_set_bounds(bitmap, bounds);
+#else
+  bitmap->bounds = bounds;
+#endif
+}
+
+
+uint8_t* raster_get_row(GBitmap *bitmap, int y) {
+  return DATA(bitmap) + (y * ROW_BYTES(bitmap));
+}
+
+
+void raster_fill(GBitmap *bitmap, GColor color) {
+  /* Set every pixel of a 1-bit bitmap or mask to black or white. */
+  memset(DATA(bitmap), IS_WHITE(color) ? 0xFF : 0x00, ROW_BYTES(bitmap) * SIZE(bitmap).h);
+}
+
+
+void raster_set_pixel(GBitmap *bitmap, int x, int y, GColor color) {
+  /* Set one pixel of a 1-bit bitmap or mask, ignoring anything outside it.
+  Bits are stored least significant first within each byte, except in
+  palettized masks, which store them most significant first. */
+  const GSize size = SIZE(bitmap);
+  if (x < 0 || y < 0 || x >= size.w || y >= size.h) return;
+  uint8_t *byte = raster_get_row(bitmap, y) + (x / 8);
+  uint8_t bit = 1 << (x % 8);
+#if defined(PBL_COLOR)
+  if (gbitmap_get_format(bitmap) == GBitmapFormat1BitPalette) bit = 0x80 >> (x % 8);
+#endif
+  if (IS_WHITE(color)) {
+    *byte |= bit;
+  } else {
+    *byte &= ~bit;
+  }
+}
+
+
+bool raster_is_white(GBitmap *bitmap, int x, int y) {
+  /* Whether one pixel is white, or for a mask drawn white.  Color screens'
+  frame buffers are 8-bit, and round ones only store the pixels inside the
+  circle; anything outside the bitmap is not white. */
+  const GSize size = SIZE(bitmap);
+  if (x < 0 || y < 0 || x >= size.w || y >= size.h) return false;
+#if defined(PBL_COLOR)
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+  if (x < row.min_x || x > row.max_x) return false;
+  switch (gbitmap_get_format(bitmap)) {
+    case GBitmapFormat8Bit:
+    case GBitmapFormat8BitCircular:
+      return gcolor_equal((GColor) { .argb = row.data[x] }, GColorWhite);
+    case GBitmapFormat1BitPalette:
+      return (row.data[x / 8] & (0x80 >> (x % 8))) != 0;
+    default:
+      break;
+  }
+#endif
+  return (raster_get_row(bitmap, y)[x / 8] & (1 << (x % 8))) != 0;
+}
+
+
+void raster_draw_line(GBitmap *bitmap, GPoint p0, GPoint p1, GColor color) {
+  /* Bresenham line between two points, both ends included. */
+  int x = p0.x;
+  int y = p0.y;
+  int dx = abs(p1.x - p0.x);
+  int dy = -abs(p1.y - p0.y);
+  int sx = (p0.x < p1.x) ? 1 : -1;
+  int sy = (p0.y < p1.y) ? 1 : -1;
+  int err = dx + dy;
+
+  while (true) {
+    raster_set_pixel(bitmap, x, y, color);
+    if (x == p1.x && y == p1.y) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y += sy;
+    }
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <pebble.h>
+
+/* Direct pixel access for offscreen bitmaps that are drawn into
+incrementally instead of being redrawn from scratch every frame.  Rasters
+are 1-bit (GBitmapFormat1Bit, which composites with And and Or on every
+platform); color screens can also have 8-bit ones, one GColor8 per byte.
+
+A mask is drawn like a 1-bit raster, in black and white.  On color screens
+it is palettized, and its black and white pixels show as the two colors
+given, either of which may be GColorClear, so it composites with
+GCompOpSet; elsewhere it is a plain 1-bit raster and the colors are
+ignored. */
+
+GBitmap* raster_create(GSize size);
+GBitmap* raster_create_mask(GSize size, GColor black, GColor white);
+#if defined(PBL_COLOR)
+GBitmap* raster_create_color(GSize size);
+#endif
+GSize raster_get_size(GBitmap *bitmap);
+void raster_set_bounds(GBitmap *bitmap, GRect bounds);  // e.g. to move a sub-bitmap to another cell of its atlas
+uint8_t* raster_get_row(GBitmap *bitmap, int y);
+void raster_fill(GBitmap *bitmap, GColor color);
+void raster_set_pixel(GBitmap *bitmap, int x, int y, GColor color);
+bool raster_is_white(GBitmap *bitmap, int x, int y);  // also reads the captured frame buffer
+void raster_draw_line(GBitmap *bitmap, GPoint p0, GPoint p1, GColor color);
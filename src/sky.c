@@ -0,0 +1,198 @@
+#include <pebble.h>
+#include "sky.h"
+#include "ephemeris.h"
+#include "raster.h"
+#include "suntable.h"
+
+#if defined(PBL_COLOR)
+// Night is left clear so the stars on the clockface show through.
+static const uint8_t SKY_COLORS[SKY_LEVELS + 1] = {
+  GColorClearARGB8,
+  GColorOxfordBlueARGB8,
+  GColorDukeBlueARGB8,
+  GColorBlueMoonARGB8,
+  GColorPictonBlueARGB8
+};
+#else
+// 4x4 ordered dither thresholds.
+static const uint8_t BAYER[4][4] = {
+  { 0,  8,  2, 10},
+  {12,  4, 14,  6},
+  { 3, 11,  1,  9},
+  {15,  7, 13,  5}
+};
+#endif
+
+
+static bool in_interval(const SkyInterval *interval, int minute) {
+  switch (interval->state) {
+    case SKY_ALWAYS:
+    case SKY_UNKNOWN:
+      return true;
+    case SKY_BETWEEN:
+      if (interval->start <= interval->end) {
+        return minute >= interval->start && minute < interval->end;
+      }
+      return minute >= interval->start || minute < interval->end;  // wraps past midnight
+    default:
+      return false;
+  }
+}
+
+
+static int minute_of_day(time_t epoch) {
+  struct tm *t = localtime(&epoch);
+  return (t->tm_hour * 60) + t->tm_min;
+}
+
+
+SkyState sky_find_epochs(time_t now, int32_t latitude, int32_t longitude, int timezone_offset, time_t *prev_sunrise, time_t *next_sunrise, time_t *prev_sunset, time_t *next_sunset) {
+  /* Offer yesterday's, today's and tomorrow's rise and set from the sun table
+  to the epochs, as the phone's are offered.  Returns today's polar day or
+  night, or SKY_UNKNOWN when the table has a rise and set or can't say. */
+  int wall = ephemeris_wall_offset(now);
+  time_t today = (now + wall) - ((now + wall) % 86400);  // UTC midnight of the local date
+  SkyState unknown = SKY_UNKNOWN;
+  for (int day = -1; day <= 1; day++) {
+    time_t midnight = today + (day * 86400);
+    int rise, set;
+    SuntableResult result = suntable_rise_and_set((int)(midnight / 86400), latitude, longitude, &rise, &set);
+    if (result == SUNTABLE_RISE_AND_SET) {
+      ephemeris_assign_epoch(now, midnight + (rise * 60) - timezone_offset, prev_sunrise, next_sunrise);
+      ephemeris_assign_epoch(now, midnight + (set * 60) - timezone_offset, prev_sunset, next_sunset);
+    }
+    if (day == 0) {
+      unknown = (result == SUNTABLE_POLAR_NIGHT) ? SKY_NEVER : (result == SUNTABLE_POLAR_DAY) ? SKY_ALWAYS : SKY_UNKNOWN;
+    }
+  }
+  return unknown;
+}
+
+
+void sky_find_horizon(time_t now, time_t prev_sunrise, time_t next_sunrise, time_t prev_sunset, time_t next_sunset, SkyState unknown, SkyInterval *above) {
+  /* Find when the sun is above the horizon.  If both epochs are valid it is
+  up between them.  If not, it is either up or down all day, and 'unknown'
+  says which when the epochs can't. */
+  time_t this_sunrise = ephemeris_select_epoch(now, prev_sunrise, next_sunrise);
+  time_t this_sunset = ephemeris_select_epoch(now, prev_sunset, next_sunset);
+
+  /* If we have a valid rise and set within 24 hours, draw
+    both sunrise and sunset, creating a day and night side. */
+  if (this_sunrise != INVALID && this_sunset != INVALID) {
+    above->state = SKY_BETWEEN;
+    above->start = minute_of_day(this_sunrise);
+    above->end = minute_of_day(this_sunset);
+  }
+
+  /* It is perpetual daylight or nighttime if both rise and set are more than 24h in future. */
+  else if (difftime(next_sunset, now)>86400 && next_sunset != INF && difftime(next_sunrise, now)>86400 && next_sunrise != INF) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: 24h day/night. next_rise=%d, next_set=%d", (int) next_sunrise, (int) next_sunset);
+
+    // Perpetual day time if the set comes first, otherwise perpetual night time.
+    above->state = (difftime(next_sunrise, next_sunset)>0) ? SKY_ALWAYS : SKY_NEVER;
+  }
+
+  /* It is perpetual nighttime since a recent set means the next set must be after next rise, and
+  the next rise will not happen for a long time. */
+  else if (difftime(now, prev_sunset)<86400 && prev_sunset != ZERO && difftime(next_sunrise, now)>86400 && next_sunrise != INF) {
+    above->state = SKY_NEVER;
+  }
+
+  /* It is perpetual daytime since a recent rise means the next rise must be after the next set,
+  and the next set will not happen for a long time. */
+  else if (difftime(now, prev_sunrise)<86400 && prev_sunrise != ZERO && difftime(next_sunset, now)>86400 && next_sunset != INF) {
+    above->state = SKY_ALWAYS;
+  }
+
+  /* Insufficient information to determine sky.  Show what the caller knows. */
+  else {
+    above->state = unknown;
+  }
+}
+
+
+void sky_find_twilight(int day, int32_t latitude, int32_t longitude, int offset, SkyInterval *above) {
+  /* Civil, nautical and astronomical twilight into above[1] to above[3]. */
+  for (int i = 1; i < SKY_LEVELS; i++) {
+    int dawn, dusk;
+    switch (suntable_twilight(day, latitude, longitude, i * 6, &dawn, &dusk)) {
+      case SUNTABLE_RISE_AND_SET:
+        above[i].state = SKY_BETWEEN;
+        above[i].start = (((dawn + offset) % 1440) + 1440) % 1440;
+        above[i].end = (((dusk + offset) % 1440) + 1440) % 1440;
+        break;
+      case SUNTABLE_POLAR_DAY:
+        above[i].state = SKY_ALWAYS;
+        break;
+      case SUNTABLE_POLAR_NIGHT:
+        above[i].state = SKY_NEVER;
+        break;
+      default:
+        above[i].state = SKY_UNKNOWN;
+        break;
+    }
+  }
+}
+
+
+void sky_nest_bands(SkyBands *bands) {
+  /* A band with no data can be no brighter than the dimmer band below it,
+  so it takes that band's if it has any, or else the brighter one's.  Then a
+  band can't be lit when the brighter one above it is always lit, nor dark
+  all day when that one isn't.  With no data at all the sky stays lit. */
+  for (int i = SKY_LEVELS - 2; i >= 0; i--) {
+    if (bands->above[i].state == SKY_UNKNOWN) bands->above[i] = bands->above[i + 1];
+  }
+  for (int i = 1; i < SKY_LEVELS; i++) {
+    SkyInterval *above = &bands->above[i];
+    if (above->state == SKY_UNKNOWN) {
+      *above = bands->above[i - 1];
+    } else if (bands->above[i - 1].state == SKY_ALWAYS) {
+      above->state = SKY_ALWAYS;
+    } else if (above->state == SKY_NEVER) {
+      *above = bands->above[i - 1];
+    }
+  }
+}
+
+
+bool sky_bands_equal(const SkyBands *a, const SkyBands *b) {
+  for (int i = 0; i < SKY_LEVELS; i++) {
+    const SkyInterval *x = &a->above[i];
+    const SkyInterval *y = &b->above[i];
+    if (x->state != y->state) return false;
+    if (x->state == SKY_BETWEEN && (x->start != y->start || x->end != y->end)) return false;
+  }
+  return true;
+}
+
+
+void sky_render(GBitmap *bitmap, const SkyBands *bands, GPoint center) {
+  /* Each pixel's angle around the center is a minute of the day, with noon
+  at the top.  How many of the intervals contain that minute picks the
+  shade: all four is daylight, none is night. */
+  const GSize size = raster_get_size(bitmap);
+#if !defined(PBL_COLOR)
+  raster_fill(bitmap, GColorBlack);
+#endif
+  for (int y = 0; y < size.h; y++) {
+#if defined(PBL_COLOR)
+    uint8_t *row = raster_get_row(bitmap, y);
+#endif
+    for (int x = 0; x < size.w; x++) {
+      int32_t angle = atan2_lookup(x - center.x, center.y - y);
+      int minute = (int)((angle * 1440 / TRIG_MAX_ANGLE + 720) % 1440);
+      int level = 0;
+      for (int i = 0; i < SKY_LEVELS; i++) {
+        if (in_interval(&bands->above[i], minute)) level++;
+      }
+#if defined(PBL_COLOR)
+      row[x] = SKY_COLORS[level];
+#else
+      if (BAYER[y % 4][x % 4] < level * 4) {
+        raster_set_pixel(bitmap, x, y, GColorWhite);
+      }
+#endif
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <pebble.h>
+
+/* The dial's sky as a cached bitmap: daylight, then civil, nautical and
+astronomical twilight as ever darker dither bands (shades of blue on color
+screens), then night.  The bitmap is 1-bit, or 8-bit on color screens.  It
+only needs rasterizing again when the bands move, about twice a day. */
+
+#define SKY_LEVELS 4               // horizon, civil, nautical, astronomical
+
+typedef enum {
+  SKY_NEVER,
+  SKY_ALWAYS,
+  SKY_BETWEEN,
+  SKY_UNKNOWN                      // no data; drawn lit, but says nothing to the bands below
+} SkyState;
+
+typedef struct {
+  SkyState state;
+  int16_t start, end;              // minutes of the local day, for SKY_BETWEEN
+} SkyInterval;
+
+typedef struct {
+  SkyInterval above[SKY_LEVELS];   // when the sun is above 0, -6, -12 and -18 degrees
+} SkyBands;
+
+// Working out the bands.  The horizon comes from the face's rise and set
+// epochs (ZERO or INF when not known), or is 'unknown' when they don't say,
+// the twilights from the sun table for a date in days since 1970, with
+// 'offset' minutes from UTC to the local day.  sky_find_epochs fills in the
+// epochs from the sun table and returns what 'unknown' should be.
+SkyState sky_find_epochs(time_t now, int32_t latitude, int32_t longitude, int timezone_offset, time_t *prev_sunrise, time_t *next_sunrise, time_t *prev_sunset, time_t *next_sunset);
+void sky_find_horizon(time_t now, time_t prev_sunrise, time_t next_sunrise, time_t prev_sunset, time_t next_sunset, SkyState unknown, SkyInterval *above);
+void sky_find_twilight(int day, int32_t latitude, int32_t longitude, int offset, SkyInterval *above);
+void sky_nest_bands(SkyBands *bands);
+
+bool sky_bands_equal(const SkyBands *a, const SkyBands *b);
+void sky_render(GBitmap *bitmap, const SkyBands *bands, GPoint center);
@@ -0,0 +1,135 @@
+#include <pebble.h>
+#include "suntable.h"
+
+// Keep in step with tools/suntable.py.
+#define VERSION 3
+#define HEADER_SIZE 6
+#define DAYS 183                     // samples per tropical year
+#define TABLE_SIZE (HEADER_SIZE + (3 * DAYS))
+#define DAY_UNITS 36000              // positions are in 1/36000 days
+#define YEAR_UNITS 13148719          // a tropical year
+#define SUN_ALTITUDE (-833)          // refraction plus solar radius, thousandths of a degree
+
+typedef struct __attribute__((__packed__)) {
+  char magic[3];
+  uint8_t version;
+  uint8_t lat_max;                   // degrees; the table wasn't checked beyond
+  uint8_t days;                      // samples per tropical year
+} Header;
+
+static uint8_t table[TABLE_SIZE];    // the whole resource, read on first use
+static const Header *header = (const Header*)table;
+static bool table_loaded = false;
+static const uint32_t noon_section = HEADER_SIZE;
+static const uint32_t decl_section = HEADER_SIZE + DAYS;
+
+
+static bool load_table() {
+  /* Every lookup interpolates eight samples, and the face makes six a day
+  (three rise and set, three twilights), so read the table in one go rather
+  than a sample at a time. */
+  if (!table_loaded) {
+    ResHandle handle = resource_get_handle(RESOURCE_ID_SUNTABLE);
+    if (resource_size(handle) != TABLE_SIZE ||
+        resource_load_byte_range(handle, 0, table, TABLE_SIZE) != TABLE_SIZE ||
+        memcmp(header->magic, "SUN", 3) != 0 || header->version != VERSION || header->days != DAYS) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "PEBBLE: Sun table is missing or the wrong version.");
+      return false;
+    }
+    table_loaded = true;
+  }
+  return true;
+}
+
+
+static int32_t read_entry(uint32_t section, int width, int sample) {
+  /* One little-endian int8 or int16 sample. */
+  const uint8_t *bytes = table + section + (sample * width);
+  return (width == 1) ? (int8_t)bytes[0] : (int16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+
+static int32_t interpolate(uint32_t section, int width, int day, int32_t units) {
+  /* A section's value 'units' (1/36000 days) after UTC noon on 'day',
+  between the samples either side in the sun's year. */
+  int64_t position = (((int64_t)day * DAY_UNITS) + units) % YEAR_UNITS;
+  if (position < 0) position += YEAR_UNITS;
+  const int64_t scaled = position * DAYS;
+  const int s0 = (int)(scaled / YEAR_UNITS);
+  const int64_t fd = scaled % YEAR_UNITS;
+  const int32_t v0 = read_entry(section, width, s0);
+  const int32_t v1 = read_entry(section, width, (s0 + 1) % DAYS);
+  return (int32_t)(((int64_t)v0 * (YEAR_UNITS - fd) + (int64_t)v1 * fd) / YEAR_UNITS);
+}
+
+
+static int32_t acos_lookup(int32_t ratio) {
+  /* Inverse of cos_lookup over [0, TRIG_MAX_ANGLE / 2], by bisection. */
+  int32_t low = 0;
+  int32_t high = TRIG_MAX_ANGLE / 2;
+  while (high - low > 1) {
+    int32_t mid = (low + high) / 2;
+    if (cos_lookup(mid) > ratio) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+
+static SuntableResult half_day(int32_t lat_angle, int32_t declination, int32_t altitude_angle, int32_t *h4) {
+  /* Solve cos(H) = (sin(altitude) - sin(lat) sin(decl)) / (cos(lat) cos(decl))
+  for the hour angle H, in quarter minutes, with the fixed-point trig tables.
+  '*h4' is left alone unless the sun crosses the altitude. */
+  const int32_t decl_angle = declination * (TRIG_MAX_ANGLE / 4) / 9000;
+
+  // Both sides in TRIG_MAX_RATIO squared.
+  const int64_t numerator = (int64_t)sin_lookup(altitude_angle) * TRIG_MAX_RATIO -
+                            (int64_t)sin_lookup(lat_angle) * sin_lookup(decl_angle);
+  const int64_t denominator = (int64_t)cos_lookup(lat_angle) * cos_lookup(decl_angle);
+  if (numerator >= denominator) return SUNTABLE_POLAR_NIGHT;   // never gets this bright
+  if (numerator <= -denominator) return SUNTABLE_POLAR_DAY;    // never gets this dark
+
+  const int32_t hour_angle = acos_lookup((int32_t)(numerator * TRIG_MAX_RATIO / denominator));
+  *h4 = (int32_t)((int64_t)hour_angle * 1440 * 4 / TRIG_MAX_ANGLE);
+  return SUNTABLE_RISE_AND_SET;
+}
+
+
+static SuntableResult crossings(int day, int32_t latitude, int32_t longitude, int32_t altitude_angle, int *first_minute, int *second_minute) {
+  /* When the sun crosses the altitude on the way up and on the way down.
+  Solve with the declination at local noon, then solve each crossing again
+  with the declination at its own time: it moves by up to 0.4 degrees a
+  day, which near the poles is many minutes.  A crossing that only just
+  happens keeps the noon answer. */
+  if (!load_table()) return SUNTABLE_UNAVAILABLE;
+  if (latitude > header->lat_max * 100 || latitude < -header->lat_max * 100) return SUNTABLE_UNAVAILABLE;
+
+  const int32_t lat_angle = latitude * (TRIG_MAX_ANGLE / 4) / 9000;
+  int32_t h4 = 0;
+  SuntableResult result = half_day(lat_angle, interpolate(decl_section, 2, day, -longitude), altitude_angle, &h4);
+  if (result != SUNTABLE_RISE_AND_SET) return result;
+
+  int32_t rise4 = h4, set4 = h4;
+  const int32_t shift = h4 * (DAY_UNITS / 1440) / 4;
+  half_day(lat_angle, interpolate(decl_section, 2, day, -longitude - shift), altitude_angle, &rise4);
+  half_day(lat_angle, interpolate(decl_section, 2, day, -longitude + shift), altitude_angle, &set4);
+
+  // Solar noon in UTC quarter minutes.
+  const int32_t noon4 = 720 * 4 - interpolate(noon_section, 1, day, -longitude) - (longitude * 16 / 100);
+  *first_minute = (noon4 - rise4) / 4;
+  *second_minute = (noon4 + set4) / 4;
+  return SUNTABLE_RISE_AND_SET;
+}
+
+
+SuntableResult suntable_rise_and_set(int day, int32_t latitude, int32_t longitude, int *rise_minute, int *set_minute) {
+  return crossings(day, latitude, longitude, SUN_ALTITUDE * TRIG_MAX_ANGLE / 360000, rise_minute, set_minute);
+}
+
+
+SuntableResult suntable_twilight(int day, int32_t latitude, int32_t longitude, int depression, int *dawn_minute, int *dusk_minute) {
+  return crossings(day, latitude, longitude, -depression * TRIG_MAX_ANGLE / 360, dawn_minute, dusk_minute);
+}
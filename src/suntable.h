@@ -0,0 +1,25 @@
+#pragma once
+#include <pebble.h>
+
+/* Sunrise, sunset and twilight from the precomputed table in RESOURCE_ID_SUNTABLE
+(generated by tools/suntable.py): the sun's equation of time and declination
+through the year, from which each crossing is solved.  The table is 555
+bytes and is read into memory on first use.  Beyond the latitudes the table
+was checked at the answer is UNAVAILABLE. */
+
+typedef enum {
+  SUNTABLE_RISE_AND_SET,
+  SUNTABLE_POLAR_NIGHT,
+  SUNTABLE_POLAR_DAY,
+  SUNTABLE_UNAVAILABLE
+} SuntableResult;
+
+// 'day' is the date, in days since 1 January 1970.  Latitude and longitude
+// are in hundredths of a degree, east positive.  Rise and set are in UTC
+// minutes from that midnight, and may fall outside 0..1439.
+SuntableResult suntable_rise_and_set(int day, int32_t latitude, int32_t longitude, int *rise_minute, int *set_minute);
+
+// When the sun crosses 'depression' degrees below the horizon (6 civil,
+// 12 nautical, 18 astronomical).  POLAR_NIGHT means it never gets that
+// bright, POLAR_DAY that it never gets that dark.
+SuntableResult suntable_twilight(int day, int32_t latitude, int32_t longitude, int depression, int *dawn_minute, int *dusk_minute);
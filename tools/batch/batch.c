@@ -0,0 +1,665 @@
+/*
+  Render the face's sky and moon over a grid of places and days of a year,
+  and check them against where the sun and moon actually are.
+
+  For every place and day the face's own code works out the sky at local
+  noon: rise and set epochs from the sun table with sky_find_epochs, as
+  fill_rise_and_set_from_table does on a watch with no phone data, then
+  sky_find_horizon, sky_find_twilight and sky_nest_bands.  Each band is compared with the sun's
+  position worked out from scratch with Meeus's low-precision sun, the one
+  tools/suntable.py checks the table against, and the moon phase with the
+  true one.  The horizon is compared with the crossings the face shows at
+  noon: the next sunrise, tomorrow's, as ephemeris_select_epoch picks it.
+
+  Output goes to the --out directory:
+
+    sky_lon<+EEE>.pgm    one contact sheet per longitude: a row of dials per
+                         latitude (north at the top), a column per sampled day
+    anomalies.jsonl      one JSON object per disagreement
+
+  A band is off when it is lit for more than --tolerance minutes of the day
+  when it shouldn't be, or dark when it should be lit.  That is an anomaly
+  unless the face or the sun has the band lit or dark for less than GRAZING
+  minutes, or the sun crosses the band's altitude one way only that day: the
+  sun only just reaches the altitude there, and a hundredth of a degree moves
+  the crossings by many minutes (the table's own check skips these days
+  too).  Nor is it one when the face drew the band as unknown because the
+  place is beyond the table's reach.  Those are written with "excused" and
+  counted apart.  Each record is tagged with the day's edge cases (24 h day
+  or night, rise after noon, set past midnight) and the summary counts them.
+
+  Places are handed to a work-stealing pool of threads: each thread starts
+  with a share of them and takes more from the others once its own run out.
+
+    --lat MIN:MAX:STEP   latitudes in degrees (default -84:84:2, the table's reach)
+    --lon MIN:MAX:STEP   longitudes in degrees (default -180:165:15)
+    --year Y             (default 2026)
+    --days N             check every Nth day (default 1)
+    --sheet-days N       a dial every Nth day on the sheets (default 14)
+    --tolerance M        minutes (default 10)
+    --threads N          (default: one per core)
+    --table F            sun table resource (default resources/data/suntable.bin)
+    --out DIR            (default batch_out)
+
+  The face's code runs as SDK 2, on the replayer's shim.  Build and run from
+  the repository root:
+
+    python tools/suntable.py resources/data/suntable.bin
+    gcc -O2 -std=c99 -D_DEFAULT_SOURCE -Dlocaltime=host_localtime -pthread \
+        -Itools/replay -Isrc -o batch tools/batch/batch.c tools/replay/pebble_host.c \
+        src/ephemeris.c src/raster.c src/sky.c src/suntable.c -lm
+    TZ=UTC ./batch
+
+  -Dlocaltime gives every thread its own localtime() result.  The exit status
+  is 1 if there were anomalies in the sky or the moon, so a clean run stays
+  at 0 and anything else is a regression.
+*/
+
+#include <pebble.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ephemeris.h"
+#include "raster.h"
+#include "sky.h"
+#include "suntable.h"
+
+#define THUMB 32                        // dial size on the contact sheets
+#define GUTTER 2
+#define OUTSIDE 128                     // sheet gray around the dials
+#define RADIANS (M_PI / 180.0)
+#define GRAZING 120                     // minutes, as tools/suntable.py skips
+
+typedef struct {
+  int lat_min, lat_max, lat_step;
+  int lon_min, lon_max, lon_step;
+  int year, day_step, sheet_step, tolerance, threads;
+  const char *table, *out;
+} Options;
+
+typedef enum {
+  TAG_DAY,                              // sun up all day
+  TAG_NIGHT,                            // sun down all day
+  TAG_RISE_AFTER_NOON,
+  TAG_SET_PAST_MIDNIGHT,
+  TAG_COUNT
+} Tag;
+
+static const char *TAG_NAMES[TAG_COUNT] = { "24h_day", "24h_night", "rise_after_noon", "set_past_midnight" };
+static const char *LEVEL_NAMES[SKY_LEVELS] = { "horizon", "civil", "nautical", "astronomical" };
+static const char *STATE_NAMES[] = { "never", "always", "between", "unknown" };
+static const double ALTITUDES[SKY_LEVELS] = { -0.833, -6, -12, -18 };
+
+typedef struct {
+  char *text;                           // anomaly records, one per line
+  size_t length, size;
+  long cases, anomalies, grazing, unknown, moon_anomalies;
+  long tag_cases[TAG_COUNT], tag_anomalies[TAG_COUNT];
+} JobResult;
+
+typedef struct {
+  pthread_mutex_t lock;
+  int *jobs;
+  int top, bottom;                      // jobs[top..bottom) wait; the owner takes from the bottom, thieves from the top
+} Deque;
+
+typedef struct {
+  int id;
+  long jobs_run, jobs_stolen;
+  GBitmap *thumb;
+} Worker;
+
+static Options options = {
+  -84, 84, 2, -180, 165, 15, 2026, 1, 14, 10, 0,
+  "resources/data/suntable.bin", "batch_out"
+};
+static int lat_count, lon_count, days_in_year;
+static int sheet_width, sheet_height;
+static uint8_t **sheets;                // one per longitude
+static JobResult *results;              // one per job, merged in job order
+static Deque *deques;
+static Worker *workers;
+
+
+/*  THE SUN AND MOON FROM SCRATCH
+    -----------------------------  */
+static double julian_day(int year, double day) {
+  /* Julian day of a fractional day of the year (0 is 1 January, 00:00 UTC). */
+  int y = year - 1;
+  return 1721425.5 + (365 * y) + (y / 4) - (y / 100) + (y / 400) + day;
+}
+
+
+static void sun_position(int year, double day, double *declination, double *equation_of_time) {
+  /* Meeus's low-precision sun, as tools/suntable.py checks the table
+  against: declination in radians, equation of time in minutes. */
+  double t = (julian_day(year, day) - 2451545.0) / 36525;
+  double l0 = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360) * RADIANS;
+  double m = (357.52911 + t * (35999.05029 - 0.0001537 * t)) * RADIANS;
+  double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+  double c = sin(m) * (1.914602 - t * (0.004817 + 0.000014 * t)) + sin(2 * m) * (0.019993 - 0.000101 * t) +
+             sin(3 * m) * 0.000289;
+  double omega = (125.04 - 1934.136 * t) * RADIANS;
+  double apparent = l0 + (c - 0.00569 - 0.00478 * sin(omega)) * RADIANS;
+  double eps0 = 23 + (26 + (21.448 - t * (46.815 + t * (0.00059 - t * 0.001813))) / 60) / 60;
+  double eps = (eps0 + 0.00256 * cos(omega)) * RADIANS;
+  *declination = asin(sin(eps) * sin(apparent));
+  double y = tan(eps / 2) * tan(eps / 2);
+  *equation_of_time = 4 * (y * sin(2 * l0) - 2 * e * sin(m) + 4 * e * y * sin(m) * cos(2 * l0) -
+                           0.5 * y * y * sin(4 * l0) - 1.25 * e * e * sin(2 * m)) / RADIANS;
+}
+
+
+static SkyState sun_event(int year, int day, double latitude, double longitude, double altitude, int direction, double *minute) {
+  /* When the sun crosses 'altitude' going up (direction -1) or down (+1), in
+  UTC minutes of the day.  Iterated so the sun's position is taken at the
+  event, not at noon.  Near a polar day or night the sun may not reach the
+  altitude at noon's declination but still cross it by midnight, so that is
+  tried once before giving up.  So close to the edge the iteration may not
+  settle, and then the sun is taken not to cross. */
+  double noon = 720 - 4 * longitude, event = noon;
+  bool tried_midnight = false;
+  SkyState state = SKY_NEVER;
+  for (int i = 0; i < 10; i++) {
+    double declination, equation_of_time;
+    sun_position(year, day + event / 1440, &declination, &equation_of_time);
+    double cos_h = (sin(altitude * RADIANS) - sin(latitude * RADIANS) * sin(declination)) /
+                   (cos(latitude * RADIANS) * cos(declination));
+    if (cos_h <= -1 || cos_h >= 1) {
+      state = (cos_h <= -1) ? SKY_ALWAYS : SKY_NEVER;
+      if (tried_midnight) return state;
+      tried_midnight = true;
+      event = noon + direction * 720;
+      continue;
+    }
+    double next = noon - equation_of_time + direction * 4 * acos(cos_h) / RADIANS;
+    if (fabs(next - event) < 0.1) {
+      *minute = next;
+      return SKY_BETWEEN;
+    }
+    event = next;
+  }
+  return state;
+}
+
+
+static unsigned sun_intervals(int year, int day, double latitude, double longitude, int offset, SkyInterval *above) {
+  /* When the sun is above each band's altitude, in local minutes.  Returns a
+  bit for each band the sun crosses one way only, as on the day a polar day
+  or night starts or ends. */
+  unsigned one_way = 0;
+  for (int i = 0; i < SKY_LEVELS; i++) {
+    double dawn, dusk;
+    SkyState rising = sun_event(year, day, latitude, longitude, ALTITUDES[i], -1, &dawn);
+    SkyState setting = sun_event(year, day, latitude, longitude, ALTITUDES[i], 1, &dusk);
+    if ((rising == SKY_BETWEEN) != (setting == SKY_BETWEEN)) one_way |= 1 << i;
+    SkyState state = (rising != SKY_BETWEEN) ? rising : setting;
+    above[i].state = state;
+    if (state == SKY_BETWEEN) {
+      above[i].start = (((int) lround(dawn) + offset) % 1440 + 1440) % 1440;
+      above[i].end = (((int) lround(dusk) + offset) % 1440 + 1440) % 1440;
+    }
+  }
+  return one_way;
+}
+
+
+static SkyState shown_event(int year, int day, double latitude, double longitude, int direction, int offset, double *minute) {
+  /* The horizon crossing the face shows at local noon, in UTC minutes from
+  today's midnight.  As ephemeris_select_epoch picks it: the next one if it
+  is within a day, else the last one if that is.  If neither, the sun is up
+  or down all day and the state says which. */
+  double event[3];
+  SkyState state[3];
+  for (int d = -1; d <= 1; d++) {
+    state[d + 1] = sun_event(year, day + d, latitude, longitude, ALTITUDES[0], direction, &event[d + 1]);
+    event[d + 1] += d * 1440;
+  }
+  for (int d = 0; d <= 2; d++) {                       // the next
+    double local = event[d] + offset;
+    if (state[d] == SKY_BETWEEN && local >= 720 && local < 720 + 1440) {
+      *minute = event[d];
+      return SKY_BETWEEN;
+    }
+  }
+  for (int d = 1; d >= 0; d--) {                       // the last
+    double local = event[d] + offset;
+    if (state[d] == SKY_BETWEEN && local < 720 && local >= 720 - 1440) {
+      *minute = event[d];
+      return SKY_BETWEEN;
+    }
+  }
+  return state[1] == SKY_BETWEEN ? SKY_NEVER : state[1];
+}
+
+
+static void sun_horizon_shown(int year, int day, double latitude, double longitude, int offset, SkyInterval *above) {
+  /* When the sun is above the horizon, from the crossings the face shows. */
+  double dawn, dusk;
+  SkyState state = shown_event(year, day, latitude, longitude, -1, offset, &dawn);
+  if (state == SKY_BETWEEN) state = shown_event(year, day, latitude, longitude, 1, offset, &dusk);
+  above->state = state;
+  if (state == SKY_BETWEEN) {
+    above->start = (((int) lround(dawn) + offset) % 1440 + 1440) % 1440;
+    above->end = (((int) lround(dusk) + offset) % 1440 + 1440) % 1440;
+  }
+}
+
+
+static double moon_phase(time_t utc) {
+  /* Fraction of the synodic month from the moon's elongation (Meeus, ch. 48). */
+  double t = (utc / 86400.0 + 2440587.5 - 2451545.0) / 36525;
+  double d = (297.8501921 + 445267.1114034 * t) * RADIANS;
+  double m = (357.5291092 + 35999.0502909 * t) * RADIANS;
+  double mp = (134.9633964 + 477198.8675055 * t) * RADIANS;
+  double i = 180 - d / RADIANS - 6.289 * sin(mp) + 2.100 * sin(m) - 1.274 * sin(2 * d - mp) -
+             0.658 * sin(2 * d) - 0.214 * sin(2 * mp) - 0.110 * sin(d);
+  double phase = (180 - i) / 360;
+  return phase - floor(phase);
+}
+
+
+/*  COMPARING
+    ---------  */
+static int segments(const SkyInterval *interval, int segment[2][2]) {
+  /* The minutes an interval covers as at most two [start, end) pieces. */
+  switch (interval->state) {
+    case SKY_ALWAYS:
+    case SKY_UNKNOWN:                  // drawn lit
+      segment[0][0] = 0;
+      segment[0][1] = 1440;
+      return 1;
+    case SKY_BETWEEN:
+      if (interval->start <= interval->end) {
+        segment[0][0] = interval->start;
+        segment[0][1] = interval->end;
+        return 1;
+      }
+      segment[0][0] = interval->start;
+      segment[0][1] = 1440;
+      segment[1][0] = 0;
+      segment[1][1] = interval->end;
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+
+static int minutes_wrong(const SkyInterval *a, const SkyInterval *b) {
+  /* Minutes of the day covered by one interval but not the other. */
+  int sa[2][2], sb[2][2];
+  int na = segments(a, sa), nb = segments(b, sb);
+  int length_a = 0, length_b = 0, overlap = 0;
+  for (int i = 0; i < na; i++) length_a += sa[i][1] - sa[i][0];
+  for (int j = 0; j < nb; j++) length_b += sb[j][1] - sb[j][0];
+  for (int i = 0; i < na; i++) {
+    for (int j = 0; j < nb; j++) {
+      int start = sa[i][0] > sb[j][0] ? sa[i][0] : sb[j][0];
+      int end = sa[i][1] < sb[j][1] ? sa[i][1] : sb[j][1];
+      if (end > start) overlap += end - start;
+    }
+  }
+  return length_a + length_b - (2 * overlap);
+}
+
+
+static bool grazing(const SkyInterval *interval) {
+  /* Whether the band is lit, or dark, for less than GRAZING minutes. */
+  int segment[2][2];
+  int count = segments(interval, segment), lit = 0;
+  for (int i = 0; i < count; i++) lit += segment[i][1] - segment[i][0];
+  return interval->state == SKY_BETWEEN && (lit < GRAZING || lit > 1440 - GRAZING);
+}
+
+
+static unsigned tags_for(const SkyInterval *horizon) {
+  unsigned tags = 0;
+  if (horizon->state == SKY_ALWAYS) tags |= 1 << TAG_DAY;
+  if (horizon->state == SKY_NEVER) tags |= 1 << TAG_NIGHT;
+  if (horizon->state == SKY_BETWEEN) {
+    if (horizon->start > 720) tags |= 1 << TAG_RISE_AFTER_NOON;
+    if (horizon->end < horizon->start) tags |= 1 << TAG_SET_PAST_MIDNIGHT;
+  }
+  return tags;
+}
+
+
+static void append(JobResult *result, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int needed = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (result->length + needed + 1 > result->size) {
+    result->size = (result->length + needed + 1) * 2;
+    result->text = realloc(result->text, result->size);
+  }
+  va_start(args, format);
+  vsnprintf(result->text + result->length, needed + 1, format, args);
+  va_end(args);
+  result->length += needed;
+}
+
+
+static void append_interval(JobResult *result, const char *name, const SkyInterval *interval) {
+  append(result, "\"%s\": \"%s\"", name, STATE_NAMES[interval->state]);
+  if (interval->state == SKY_BETWEEN) {
+    append(result, ", \"%s_start\": %d, \"%s_end\": %d", name, interval->start, name, interval->end);
+  }
+}
+
+
+/*  ONE PLACE, EVERY DAY
+    --------------------  */
+static void face_bands(time_t now, int day, int32_t latitude, int32_t longitude, int timezone_offset, SkyBands *bands) {
+  /* The sky the face draws at 'now' (SDK 2 watch time) with rise and set
+  from the sun table, as when it has no data from the phone: the same calls
+  fill_rise_and_set_from_table and find_sky_bands make. */
+  time_t prev_sunrise = ZERO, next_sunrise = INF, prev_sunset = ZERO, next_sunset = INF;
+  SkyState unknown = sky_find_epochs(now, latitude, longitude, timezone_offset,
+                                     &prev_sunrise, &next_sunrise, &prev_sunset, &next_sunset);
+  sky_find_horizon(now, prev_sunrise, next_sunrise, prev_sunset, next_sunset, unknown, &bands->above[0]);
+  sky_find_twilight(day, latitude, longitude, -timezone_offset / 60, bands->above);
+  sky_nest_bands(bands);
+}
+
+
+static void draw_thumb(Worker *worker, const SkyBands *bands, int lon_index, int row, int column) {
+  /* Render the dial into the worker's bitmap and copy it onto the sheet.
+  Every job owns its own row, so no locking is needed. */
+  sky_render(worker->thumb, bands, GPoint(THUMB / 2, THUMB / 2));
+  uint8_t *sheet = sheets[lon_index];
+  int x0 = GUTTER + column * (THUMB + GUTTER);
+  int y0 = GUTTER + row * (THUMB + GUTTER);
+  for (int y = 0; y < THUMB; y++) {
+    uint8_t *bits = raster_get_row(worker->thumb, y);
+    for (int x = 0; x < THUMB; x++) {
+      int dx = 2 * x + 1 - THUMB, dy = 2 * y + 1 - THUMB;
+      bool inside = (dx * dx) + (dy * dy) <= THUMB * THUMB;
+      bool white = bits[x / 8] & (1 << (x % 8));
+      sheet[(y0 + y) * sheet_width + x0 + x] = !inside ? OUTSIDE : (white ? 255 : 0);
+    }
+  }
+}
+
+
+static void date_of(int day, int *month, int *month_day) {
+  static const int DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  *month = 0;
+  while (*month < 11) {
+    int length = DAYS[*month] + (*month == 1 && days_in_year == 366);
+    if (day < length) break;
+    day -= length;
+    (*month)++;
+  }
+  *month_day = day + 1;
+}
+
+
+static void run_job(Worker *worker, int job) {
+  /* Check one place on every day of the year. */
+  JobResult *result = &results[job];
+  int lat_index = job / lon_count, lon_index = job % lon_count;
+  int lat = options.lat_max - (lat_index * options.lat_step);
+  int lon = options.lon_min + (lon_index * options.lon_step);
+  int zone = (int) lround(lon / 15.0);
+  int timezone_offset = -zone * 3600;   // the phone's UTC - local
+  time_t jan1 = (time_t) ((julian_day(options.year, 0) - 2440587.5) * 86400);
+
+  for (int day = 0; day < days_in_year; day += options.day_step) {
+    time_t now = jan1 + (day * 86400) + (12 * 3600);  // local noon, as SDK 2 keeps it
+    SkyBands face, sun;
+    face_bands(now, (int)(now / 86400), lat * 100, lon * 100, timezone_offset, &face);
+    unsigned one_way = sun_intervals(options.year, day, lat, lon, zone * 60, sun.above);
+    unsigned tags = tags_for(&sun.above[0]);
+    sun_horizon_shown(options.year, day, lat, lon, zone * 60, &sun.above[0]);
+    bool anomaly = false, grazed = false, unknown = false;
+    int month, month_day;
+    date_of(day, &month, &month_day);
+    for (int i = 0; i < SKY_LEVELS; i++) {
+      int wrong = minutes_wrong(&face.above[i], &sun.above[i]);
+      if (wrong <= options.tolerance) continue;
+      const char *excused = NULL;
+      if (face.above[i].state == SKY_UNKNOWN) {
+        excused = "unknown";
+        unknown = true;
+      } else if (grazing(&face.above[i]) || grazing(&sun.above[i]) || (one_way & (1 << i))) {
+        excused = "grazing";
+        grazed = true;
+      } else {
+        anomaly = true;
+      }
+      append(result, "{\"lat\": %d, \"lon\": %d, \"date\": \"%d-%02d-%02d\", \"band\": \"%s\", \"minutes\": %d, ",
+             lat, lon, options.year, month + 1, month_day, LEVEL_NAMES[i], wrong);
+      append_interval(result, "face", &face.above[i]);
+      append(result, ", ");
+      append_interval(result, "sun", &sun.above[i]);
+      if (excused) append(result, ", \"excused\": \"%s\"", excused);
+      append(result, ", \"tags\": [");
+      for (int t = 0, first = 1; t < TAG_COUNT; t++) {
+        if (tags & (1 << t)) {
+          append(result, "%s\"%s\"", first ? "" : ", ", TAG_NAMES[t]);
+          first = 0;
+        }
+      }
+      append(result, "]}\n");
+    }
+
+    // The moon: the image shown should be the true phase's, or the next one.
+    double face_phase = ephemeris_moon_phase(now, timezone_offset);
+    double true_phase = moon_phase(now + timezone_offset);
+    int img_type, img_rotation;
+    ephemeris_moon_image(now, face_phase, &img_type, &img_rotation);
+    int true_type = ((int) ((true_phase + 0.0625) / 0.125)) % 8;
+    int steps = abs(img_type - true_type);
+    if (img_type < 8 && steps > 1 && steps < 7) {
+      result->moon_anomalies++;
+      append(result, "{\"lat\": %d, \"lon\": %d, \"date\": \"%d-%02d-%02d\", \"band\": \"moon\", "
+             "\"face_phase\": %.3f, \"moon_phase\": %.3f, \"face_image\": %d, \"moon_image\": %d}\n",
+             lat, lon, options.year, month + 1, month_day, face_phase, true_phase, img_type, true_type);
+    }
+
+    result->cases++;
+    if (anomaly) result->anomalies++;
+    else if (grazed) result->grazing++;
+    else if (unknown) result->unknown++;
+    for (int t = 0; t < TAG_COUNT; t++) {
+      if (!(tags & (1 << t))) continue;
+      result->tag_cases[t]++;
+      if (anomaly) result->tag_anomalies[t]++;
+    }
+    if (day % options.sheet_step == 0) {
+      draw_thumb(worker, &face, lon_index, lat_index, day / options.sheet_step);
+    }
+  }
+}
+
+
+/*  WORK-STEALING POOL
+    ------------------  */
+static bool take_own(Deque *deque, int *job) {
+  pthread_mutex_lock(&deque->lock);
+  bool found = deque->bottom > deque->top;
+  if (found) *job = deque->jobs[--deque->bottom];
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+
+static bool steal(Deque *deque, int *job) {
+  pthread_mutex_lock(&deque->lock);
+  bool found = deque->bottom > deque->top;
+  if (found) *job = deque->jobs[deque->top++];
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+
+static void *worker_main(void *data) {
+  /* Work through our own deque, then steal from the others.  No job makes
+  new ones, so once a full round of stealing finds nothing we are done. */
+  Worker *worker = data;
+  int job;
+  for (;;) {
+    if (take_own(&deques[worker->id], &job)) {
+      run_job(worker, job);
+      worker->jobs_run++;
+      continue;
+    }
+    bool stolen = false;
+    for (int i = 1; i < options.threads && !stolen; i++) {
+      stolen = steal(&deques[(worker->id + i) % options.threads], &job);
+    }
+    if (!stolen) break;
+    run_job(worker, job);
+    worker->jobs_run++;
+    worker->jobs_stolen++;
+  }
+  return NULL;
+}
+
+
+static void run_pool(int job_count) {
+  /* Deal the jobs out in contiguous runs, one per thread, and start them. */
+  pthread_t *threads = calloc(options.threads, sizeof(pthread_t));
+  deques = calloc(options.threads, sizeof(Deque));
+  workers = calloc(options.threads, sizeof(Worker));
+  for (int t = 0; t < options.threads; t++) {
+    int first = (int) ((long) job_count * t / options.threads);
+    int last = (int) ((long) job_count * (t + 1) / options.threads);
+    pthread_mutex_init(&deques[t].lock, NULL);
+    deques[t].jobs = malloc(sizeof(int) * (last - first + 1));
+    deques[t].top = 0;
+    deques[t].bottom = 0;
+    for (int job = last - 1; job >= first; job--) deques[t].jobs[deques[t].bottom++] = job;
+    workers[t].id = t;
+    workers[t].thumb = raster_create(GSize(THUMB, THUMB));
+  }
+  for (int t = 0; t < options.threads; t++) pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+  for (int t = 0; t < options.threads; t++) pthread_join(threads[t], NULL);
+  free(threads);
+}
+
+
+/*  OUTPUT
+    ------  */
+static bool write_sheet(int lon_index) {
+  char path[512];
+  int lon = options.lon_min + (lon_index * options.lon_step);
+  snprintf(path, sizeof(path), "%s/sky_lon%+04d.pgm", options.out, lon);
+  FILE *file = fopen(path, "wb");
+  if (!file) return false;
+  fprintf(file, "P5\n%d %d\n255\n", sheet_width, sheet_height);
+  fwrite(sheets[lon_index], 1, (size_t) sheet_width * sheet_height, file);
+  fclose(file);
+  return true;
+}
+
+
+static bool write_report(int job_count) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/anomalies.jsonl", options.out);
+  FILE *file = fopen(path, "w");
+  if (!file) return false;
+  for (int job = 0; job < job_count; job++) {
+    if (results[job].length) fwrite(results[job].text, 1, results[job].length, file);
+  }
+  fclose(file);
+  return true;
+}
+
+
+static bool parse_range(const char *text, int *min, int *max, int *step) {
+  return sscanf(text, "%d:%d:%d", min, max, step) == 3 && *step > 0 && *min <= *max;
+}
+
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    bool ok = value != NULL;
+    if (ok && strcmp(argv[i], "--lat") == 0) ok = parse_range(value, &options.lat_min, &options.lat_max, &options.lat_step);
+    else if (ok && strcmp(argv[i], "--lon") == 0) ok = parse_range(value, &options.lon_min, &options.lon_max, &options.lon_step);
+    else if (ok && strcmp(argv[i], "--year") == 0) options.year = atoi(value);
+    else if (ok && strcmp(argv[i], "--days") == 0) ok = (options.day_step = atoi(value)) > 0;
+    else if (ok && strcmp(argv[i], "--sheet-days") == 0) ok = (options.sheet_step = atoi(value)) > 0;
+    else if (ok && strcmp(argv[i], "--tolerance") == 0) options.tolerance = atoi(value);
+    else if (ok && strcmp(argv[i], "--threads") == 0) ok = (options.threads = atoi(value)) > 0;
+    else if (ok && strcmp(argv[i], "--table") == 0) options.table = value;
+    else if (ok && strcmp(argv[i], "--out") == 0) options.out = value;
+    else ok = false;
+    if (!ok) {
+      fprintf(stderr, "usage: batch [--lat MIN:MAX:STEP] [--lon MIN:MAX:STEP] [--year Y] [--days N]\n"
+                      "             [--sheet-days N] [--tolerance M] [--threads N] [--table F] [--out DIR]\n");
+      return 2;
+    }
+    i++;
+  }
+  if (options.threads == 0) options.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (options.threads < 1) options.threads = 1;
+  if (options.sheet_step % options.day_step != 0) options.sheet_step = options.day_step;
+
+  if (!host_load_resource(RESOURCE_ID_SUNTABLE, options.table)) {
+    fprintf(stderr, "batch: can't read %s\n", options.table);
+    return 2;
+  }
+  int rise, set;
+  suntable_rise_and_set(0, 0, 0, &rise, &set);  // load the table before the threads start
+  mkdir(options.out, 0777);
+
+  days_in_year = 365 + ((options.year % 4 == 0 && options.year % 100 != 0) || options.year % 400 == 0);
+  lat_count = (options.lat_max - options.lat_min) / options.lat_step + 1;
+  lon_count = (options.lon_max - options.lon_min) / options.lon_step + 1;
+  int columns = (days_in_year + options.sheet_step - 1) / options.sheet_step;
+  sheet_width = GUTTER + columns * (THUMB + GUTTER);
+  sheet_height = GUTTER + lat_count * (THUMB + GUTTER);
+  sheets = calloc(lon_count, sizeof(uint8_t*));
+  for (int i = 0; i < lon_count; i++) {
+    sheets[i] = malloc((size_t) sheet_width * sheet_height);
+    memset(sheets[i], OUTSIDE, (size_t) sheet_width * sheet_height);
+  }
+  int job_count = lat_count * lon_count;
+  results = calloc(job_count, sizeof(JobResult));
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  run_pool(job_count);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  for (int i = 0; i < lon_count; i++) {
+    if (!write_sheet(i)) fprintf(stderr, "batch: can't write a sheet in %s\n", options.out);
+  }
+  if (!write_report(job_count)) fprintf(stderr, "batch: can't write %s/anomalies.jsonl\n", options.out);
+
+  JobResult total = {0};
+  for (int job = 0; job < job_count; job++) {
+    total.cases += results[job].cases;
+    total.anomalies += results[job].anomalies;
+    total.grazing += results[job].grazing;
+    total.unknown += results[job].unknown;
+    total.moon_anomalies += results[job].moon_anomalies;
+    for (int t = 0; t < TAG_COUNT; t++) {
+      total.tag_cases[t] += results[job].tag_cases[t];
+      total.tag_anomalies[t] += results[job].tag_anomalies[t];
+    }
+  }
+  long stolen = 0;
+  for (int t = 0; t < options.threads; t++) stolen += workers[t].jobs_stolen;
+
+  printf("places        %d (%d latitudes x %d longitudes), %d days\n", job_count, lat_count, lon_count,
+         (days_in_year + options.day_step - 1) / options.day_step);
+  printf("time          %.2f s on %d threads, %.0f place-days/s, %ld of %d places stolen\n",
+         seconds, options.threads, total.cases / seconds, stolen, job_count);
+  printf("sky           %ld of %ld place-days off by more than %d minutes\n", total.anomalies, total.cases, options.tolerance);
+  printf("  %-20s %ld more off only where the sun grazes a band\n", "grazing", total.grazing);
+  printf("  %-20s %ld more off only where the table has no answer\n", "unknown", total.unknown);
+  for (int t = 0; t < TAG_COUNT; t++) {
+    printf("  %-20s %ld of %ld\n", TAG_NAMES[t], total.tag_anomalies[t], total.tag_cases[t]);
+  }
+  printf("moon          %ld place-days showing the wrong image\n", total.moon_anomalies);
+  printf("output        %s/\n", options.out);
+  return (total.anomalies || total.moon_anomalies) ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+"""
+Generate the moon atlases, images/moons_b.png and images/moons_w.png, from
+the separate moon masks.
+
+Each atlas is one row of MOON_DIAMETER-wide cells in the order of CELLS,
+which is the order MOON_CELLS in src/natural.h indexes.  The face loads
+both atlases once and shows a phase by moving a sub-bitmap's bounds to its
+cell, so changing the moon never touches the heap.  The separate masks
+under images/moons stay the source.  Needs Pillow (pip install Pillow).
+Edit the masks and run, from the repository root:
+
+    python tools/moon_atlas.py
+    python tools/platform_images.py
+"""
+
+from __future__ import division, print_function
+
+import os
+import sys
+
+from PIL import Image
+
+IMAGES = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'resources', 'images')
+
+MOON_DIAMETER = 21         # MOON_DIAMETER in src/natural.h
+THRESHOLD = 128
+
+CELLS = (['moons/new', 'moons/full'] +
+         ['moons/crescent_%d' % r for r in range(8)] +
+         ['moons/quarter_%d' % r for r in range(8)] +
+         ['moons/gibbous_%d' % r for r in range(8)] +
+         ['ds'])
+
+
+def load_mask(path):
+    """ The mask as 1-bit black/white, ignoring any (unused) alpha. """
+    return Image.open(path).convert('L').point(lambda v: 255 if v >= THRESHOLD else 0)
+
+
+def build(suffix):
+    atlas = Image.new('L', (MOON_DIAMETER * len(CELLS), MOON_DIAMETER), 255 if suffix == '_b' else 0)
+    for i, name in enumerate(CELLS):
+        mask = load_mask(os.path.join(IMAGES, name + suffix + '.png'))
+        if mask.size != (MOON_DIAMETER, MOON_DIAMETER):
+            raise ValueError('%s%s.png is %dx%d, not %dx%d' % ((name, suffix) + mask.size + (MOON_DIAMETER, MOON_DIAMETER)))
+        atlas.paste(mask, (i * MOON_DIAMETER, 0))
+    return atlas.convert('1')
+
+
+def generate():
+    for suffix in ('_b', '_w'):
+        path = os.path.join(IMAGES, 'moons' + suffix + '.png')
+        build(suffix).save(path, optimize=True)
+        print('wrote', os.path.relpath(path))
+
+
+if __name__ == '__main__':
+    generate()
+    sys.exit(0)
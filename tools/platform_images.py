@@ -0,0 +1,97 @@
+"""
+Generate the color and round variants of the black/white sprite masks.
+
+On 1-bit screens every sprite is a pair of opaque masks composited with And
+(the *_b images) and Or (the *_w images).  Color screens can't And or Or, so
+each mask gets an alpha variant that keeps only the pixels that change the
+screen -- black for *_b, white for *_w -- and is drawn with GCompOpSet.  The
+SDK picks the variant by its ~tag:
+
+    *_b~color.png, *_w~color.png           basalt and chalk sprites
+    face_bg_black~basalt.png               rectangular face mask, alpha
+    face_bg_black~chalk.png                round face mask, alpha
+    face_bg_white~chalk.png                round face, opaque (it is Assigned)
+
+The round faces are the rectangular dial scaled to CLOCK_RAD in natural.h's
+PBL_ROUND geometry.  Needs Pillow (pip install Pillow).  Run from the
+repository root after changing any of the source images:
+
+    python tools/platform_images.py
+"""
+
+from __future__ import division, print_function
+
+import os
+import sys
+
+from PIL import Image
+
+IMAGES = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'resources', 'images')
+
+RECT_CENTER = (72, 84)
+RECT_RAD = 72
+ROUND_SIZE = 180
+ROUND_RAD = 84             # CLOCK_RAD for PBL_ROUND in src/natural.h
+THRESHOLD = 128
+
+
+def is_black_mask(name):
+    return name.endswith('_b') or name.endswith('_black')
+
+
+def is_white_mask(name):
+    return name.endswith('_w') or name.endswith('_white')
+
+
+def load_mask(path):
+    """ The mask as 1-bit black/white, ignoring any (unused) alpha. """
+    return Image.open(path).convert('L').point(lambda v: 255 if v >= THRESHOLD else 0)
+
+
+def alpha_variant(mask, keep_black):
+    """ An RGBA image keeping only the black (or only the white) pixels. """
+    out = Image.new('RGBA', mask.size, (0, 0, 0, 0))
+    color = (0, 0, 0, 255) if keep_black else (255, 255, 255, 255)
+    keep = mask.point(lambda v: 255 if (v == 0) == keep_black else 0)
+    out.paste(color, (0, 0), keep)
+    return out
+
+
+def round_face(mask):
+    """ Scale the dial of a rectangular face mask onto the round screen. """
+    cx, cy = RECT_CENTER
+    dial = mask.crop((cx - RECT_RAD, cy - RECT_RAD, cx + RECT_RAD, cy + RECT_RAD))
+    size = 2 * ROUND_RAD
+    dial = dial.resize((size, size), Image.LANCZOS).point(lambda v: 255 if v >= THRESHOLD else 0)
+    out = Image.new('L', (ROUND_SIZE, ROUND_SIZE), 0)
+    offset = (ROUND_SIZE - size) // 2
+    out.paste(dial, (offset, offset))
+    return out
+
+
+def save(image, path):
+    image.save(path, optimize=True)
+    print('wrote', os.path.relpath(path))
+
+
+def generate():
+    for root, _, files in os.walk(IMAGES):
+        for filename in sorted(files):
+            name, ext = os.path.splitext(filename)
+            if ext != '.png' or '~' in name:
+                continue
+            path = os.path.join(root, filename)
+
+            if name == 'face_bg_black':
+                mask = load_mask(path)
+                save(alpha_variant(mask, True), os.path.join(root, name + '~basalt.png'))
+                save(alpha_variant(round_face(mask), True), os.path.join(root, name + '~chalk.png'))
+            elif name == 'face_bg_white':
+                save(round_face(load_mask(path)), os.path.join(root, name + '~chalk.png'))
+            elif is_black_mask(name) or is_white_mask(name):
+                save(alpha_variant(load_mask(path), is_black_mask(name)), os.path.join(root, name + '~color.png'))
+
+
+if __name__ == '__main__':
+    generate()
+    sys.exit(0)
@@ -0,0 +1,146 @@
+/*
+  Round-trip test of src/history.c on a computer: add samples, then read
+  them back with history_foreach and history_last, and again after a save
+  and load through the shim's persistent storage.
+
+  Each run adds random samples (temperature changes and repeats in both
+  directions, sunrise and sunset epochs either side of the record's minute,
+  and the clock now and then going backwards) until the ring has filled and
+  wrapped many times over, with stretches of temperatures alone long enough
+  to push every sun event out.  After every sample the ring must hold a suffix
+  of what was added, decoded exactly as it went in, with at least the newest
+  sample in it, and history_last must agree with a scan of the ring.  Build
+  and run from the repository root:
+
+    gcc -O2 -std=c99 -D_DEFAULT_SOURCE -Wall -Itools/replay -o history_test \
+        tools/replay/history_test.c tools/replay/pebble_host.c src/history.c -lm
+    ./history_test
+
+  The exit status is 1 if any check failed.
+*/
+
+#include <pebble.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../src/history.h"
+
+#define KEY 1
+#define RUNS 20
+#define SAMPLES 5000
+
+static HistorySample added[SAMPLES];
+static int added_count = 0;
+static HistorySample ring[SAMPLES];
+static int ring_count = 0;
+
+
+static bool collect(const HistorySample *sample, void *context) {
+  ring[ring_count++] = *sample;
+  return true;
+}
+
+
+static bool same(const HistorySample *a, const HistorySample *b) {
+  return a->kind == b->kind && a->time == b->time && a->value == b->value;
+}
+
+
+static int check(int run, const char *when) {
+  /* The ring must be the newest samples added, in order. */
+  ring_count = 0;
+  history_foreach(0, collect, NULL);
+  int first = added_count - ring_count;
+  if (ring_count == 0 || first < 0) {
+    printf("run %d, sample %d %s: %d samples in the ring\n", run, added_count, when, ring_count);
+    return 1;
+  }
+  for (int i = 0; i < ring_count; i++) {
+    if (!same(&ring[i], &added[first + i])) {
+      printf("run %d, sample %d %s: ring[%d] is kind %d at %ld = %ld, not kind %d at %ld = %ld\n",
+             run, added_count, when, i, ring[i].kind, (long)ring[i].time, (long)ring[i].value,
+             added[first + i].kind, (long)added[first + i].time, (long)added[first + i].value);
+      return 1;
+    }
+  }
+
+  const HistoryKind kinds[] = {HISTORY_TEMPERATURE, HISTORY_SUNRISE, HISTORY_SUNSET};
+  for (int k = 0; k < 3; k++) {
+    const HistorySample *expected = NULL;
+    for (int i = 0; i < ring_count; i++) {
+      if (ring[i].kind == kinds[k]) expected = &ring[i];
+    }
+    HistorySample last;
+    bool found = history_last(kinds[k], &last);
+    if (found != (expected != NULL) || (found && !same(&last, expected))) {
+      printf("run %d, sample %d %s: history_last(%d) disagrees with the ring\n", run, added_count, when, kinds[k]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+static int run(int number) {
+  /* Fill and wrap the ring from empty, checking after every sample. */
+  persist_delete(KEY);
+  history_load(KEY);
+  added_count = 0;
+
+  time_t now = 1700000000 + (rand() % 86400) * 60;
+  int32_t temperature = (rand() % 120) - 40;
+  int32_t minute = 0;
+  int failures = 0;
+  for (int i = 0; i < SAMPLES && failures == 0; i++) {
+    int step = rand() % 100;
+    if (step < 3) {
+      now -= (rand() % 120) * 60;                      // the user sets the clock back
+    } else if (step < 6) {
+      now += (rand() % 100000) * 60;                   // the watch was off for a while
+    } else {
+      now += (rand() % 45) * 60 + (rand() % 60);
+    }
+
+    // Every other stretch has no sun events, so the ring drops the last of them.
+    HistorySample sample;
+    int choice = ((i / 500) % 2) ? 0 : rand() % 10;
+    if (choice < 7) {
+      if (rand() % 3) temperature += (rand() % 41) - 20;
+      if (rand() % 50 == 0) temperature = (rand() % 2) ? 20000 : -20000;     // far from the last
+      sample = (HistorySample) { .kind = HISTORY_TEMPERATURE, .value = temperature };
+    } else {
+      // A sun event within a day or so either side of now.
+      sample = (HistorySample) {
+        .kind = (choice < 9) ? HISTORY_SUNRISE : HISTORY_SUNSET,
+        .value = (int32_t)now + ((rand() % 200000) - 100000)
+      };
+    }
+    history_add(sample.kind, now, sample.value);
+
+    // What it should read back as: the minute never goes backwards, and
+    // sun events are kept to the minute.
+    int32_t sample_minute = (int32_t)(now / 60);
+    if (added_count == 0 || sample_minute > minute) minute = sample_minute;
+    sample.time = (time_t)minute * 60;
+    if (sample.kind != HISTORY_TEMPERATURE) sample.value = (sample.value / 60) * 60;
+    added[added_count++] = sample;
+
+    failures += check(number, "after adding");
+    if (i % 97 == 0) {
+      history_save(KEY);
+      history_load(KEY);
+      failures += check(number, "after a reload");
+    }
+  }
+  return failures;
+}
+
+
+int main(int argc, char **argv) {
+  srand(1);
+  int failures = 0;
+  for (int i = 0; i < RUNS; i++) {
+    failures += run(i);
+  }
+  printf("%d runs of %d samples: %s\n", RUNS, SAMPLES, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
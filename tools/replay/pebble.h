@@ -0,0 +1,260 @@
+#pragma once
+
+/* Just enough of the SDK 2 API to run the face on a computer.  Drawing is a
+no-op, persistent storage lives in memory, and the clock is whatever the
+replayer sets it to.  Everything the face calls is implemented in
+pebble_host.c; the host_* functions are for the replayer. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "resource_ids.h"
+
+// The face reads the clock through time(); the replayer controls it.
+time_t host_time(time_t *t);
+#define time(t) host_time(t)
+
+// The face's heap allocations, and the SDK's below, all go through the shim
+// so the replayer can count them.
+void *host_malloc(size_t size, const char *site);
+void host_free(void *pointer);
+#define HOST_STRING(x) #x
+#define HOST_SITE(line) __FILE__ ":" HOST_STRING(line)
+#define malloc(size) host_malloc((size), HOST_SITE(__LINE__))
+#define free(pointer) host_free(pointer)
+
+
+/*  GRAPHICS TYPES
+    --------------  */
+typedef struct { int16_t x, y; } GPoint;
+typedef struct { int16_t w, h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint) { (x), (y) })
+#define GSize(w, h) ((GSize) { (w), (h) })
+#define GRect(x, y, w, h) ((GRect) { { (x), (y) }, { (w), (h) } })
+
+typedef enum { GColorClear = -1, GColorBlack = 0, GColorWhite = 1 } GColor;
+typedef enum { GCompOpAssign, GCompOpAssignInverted, GCompOpOr, GCompOpAnd, GCompOpClear, GCompOpSet } GCompOp;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+typedef enum { GCornerNone = 0 } GCornerMask;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill } GTextOverflowMode;
+
+typedef struct {
+  void *addr;
+  uint16_t row_size_bytes;
+  uint16_t info_flags;
+  GRect bounds;
+} GBitmap;
+
+typedef struct { uint32_t num_points; GPoint *points; } GPathInfo;
+typedef struct GPath GPath;
+typedef struct GContext GContext;
+typedef const char* GFont;
+
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_DROID_SERIF_28_BOLD "RESOURCE_ID_DROID_SERIF_28_BOLD"
+
+
+/*  LAYERS AND WINDOWS
+    ------------------  */
+typedef struct Layer Layer;
+typedef struct TextLayer TextLayer;
+typedef struct BitmapLayer BitmapLayer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+typedef void (*WindowHandler)(Window *window);
+typedef struct {
+  WindowHandler load, appear, disappear, unload;
+} WindowHandlers;
+
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_remove_from_parent(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc proc);
+void layer_mark_dirty(Layer *layer);
+GRect layer_get_frame(Layer *layer);
+GRect layer_get_bounds(Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+void layer_set_bounds(Layer *layer, GRect bounds);
+void layer_set_hidden(Layer *layer, bool hidden);
+
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *layer);
+void text_layer_set_text(TextLayer *layer, const char *text);
+void text_layer_set_text_color(TextLayer *layer, GColor color);
+void text_layer_set_background_color(TextLayer *layer, GColor color);
+void text_layer_set_font(TextLayer *layer, GFont font);
+void text_layer_set_text_alignment(TextLayer *layer, GTextAlignment alignment);
+GFont fonts_get_system_font(const char *key);
+
+BitmapLayer *bitmap_layer_create(GRect frame);
+void bitmap_layer_destroy(BitmapLayer *layer);
+Layer *bitmap_layer_get_layer(BitmapLayer *layer);
+void bitmap_layer_set_bitmap(BitmapLayer *layer, GBitmap *bitmap);
+void bitmap_layer_set_background_color(BitmapLayer *layer, GColor color);
+void bitmap_layer_set_compositing_mode(BitmapLayer *layer, GCompOp mode);
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id);
+GBitmap *gbitmap_create_blank(GSize size);
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base, GRect sub_rect);
+void gbitmap_destroy(GBitmap *bitmap);
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t radius, GCornerMask corners);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                        GTextAlignment alignment, void *layout);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+GSize graphics_text_layout_get_content_size(const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                                            GTextAlignment alignment);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+Window *window_create(void);
+void window_destroy(Window *window);
+Layer *window_get_root_layer(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_stack_push(Window *window, bool animated);
+
+
+/*  EVENTS AND TIMERS
+    -----------------  */
+typedef enum { SECOND_UNIT = 1, MINUTE_UNIT = 2, HOUR_UNIT = 4, DAY_UNIT = 8 } TimeUnits;
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+typedef enum { ACCEL_AXIS_X, ACCEL_AXIS_Y, ACCEL_AXIS_Z } AccelAxisType;
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+typedef struct { uint8_t charge_percent; bool is_charging; bool is_plugged; } BatteryChargeState;
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+void bluetooth_connection_service_subscribe(void (*handler)(bool connected));
+void bluetooth_connection_service_unsubscribe(void);
+bool bluetooth_connection_service_peek(void);
+void battery_state_service_subscribe(void (*handler)(BatteryChargeState charge));
+void battery_state_service_unsubscribe(void);
+BatteryChargeState battery_state_service_peek(void);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *data);
+bool app_timer_reschedule(AppTimer *timer, uint32_t timeout_ms);
+void app_timer_cancel(AppTimer *timer);
+void app_event_loop(void);
+
+
+/*  APP MESSAGES
+    ------------  */
+typedef enum { APP_MSG_OK = 0, APP_MSG_SEND_TIMEOUT = 2, APP_MSG_BUSY = 64 } AppMessageResult;
+typedef enum { TUPLE_BYTE_ARRAY = 0, TUPLE_CSTRING = 1, TUPLE_UINT = 2, TUPLE_INT = 3 } TupleType;
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+
+#define HOST_DICT_TUPLES 16
+#define HOST_DICT_BYTES 512
+typedef struct {
+  Tuple *tuples[HOST_DICT_TUPLES];
+  int count;
+  size_t used;
+  uint8_t buffer[HOST_DICT_BYTES];
+} DictionaryIterator;
+
+typedef struct {
+  TupleType type;
+  uint32_t key;
+  union {
+    struct { const uint8_t *data; uint16_t length; } bytes;
+    struct { const char *data; uint16_t length; } cstring;
+    struct { uint32_t storage; uint16_t width; } integer;
+  };
+} Tuplet;
+
+#define TupletCString(_key, _cstring) \
+  ((const Tuplet) { .type = TUPLE_CSTRING, .key = _key, .cstring = { .data = _cstring, .length = _cstring ? strlen(_cstring) + 1 : 0 } })
+#define TupletInteger(_key, _integer) \
+  ((const Tuplet) { .type = TUPLE_INT, .key = _key, .integer = { .storage = _integer, .width = sizeof(_integer) } })
+#define TupletBytes(_key, _data, _length) \
+  ((const Tuplet) { .type = TUPLE_BYTE_ARRAY, .key = _key, .bytes = { .data = _data, .length = _length } })
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, void *context);
+
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key);
+int dict_write_tuplet(DictionaryIterator *iter, const Tuplet *tuplet);
+AppMessageResult app_message_open(uint32_t inbox_size, uint32_t outbox_size);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iter);
+AppMessageResult app_message_outbox_send(void);
+void app_message_register_inbox_received(AppMessageInboxReceived handler);
+void app_message_register_inbox_dropped(AppMessageInboxDropped handler);
+void app_message_register_outbox_sent(AppMessageOutboxSent handler);
+void app_message_register_outbox_failed(AppMessageOutboxFailed handler);
+
+
+/*  STORAGE, RESOURCES, LOGGING
+    ---------------------------  */
+#define PERSIST_DATA_MAX_LENGTH 256
+bool persist_exists(uint32_t key);
+int persist_get_size(uint32_t key);
+int32_t persist_read_int(uint32_t key);
+int persist_write_int(uint32_t key, int32_t value);
+int persist_read_data(uint32_t key, void *buffer, size_t size);
+int persist_write_data(uint32_t key, const void *data, size_t size);
+int persist_delete(uint32_t key);
+int persist_read_string(uint32_t key, char *buffer, size_t size);
+int persist_write_string(uint32_t key, const char *string);
+
+typedef void* ResHandle;
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle handle);
+size_t resource_load_byte_range(ResHandle handle, uint32_t start, uint8_t *buffer, size_t size);
+
+enum { APP_LOG_LEVEL_ERROR = 1, APP_LOG_LEVEL_WARNING = 50, APP_LOG_LEVEL_INFO = 100, APP_LOG_LEVEL_DEBUG = 200 };
+void host_log(int level, const char *file, int line, const char *fmt, ...);
+#define APP_LOG(level, fmt, ...) host_log(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+
+
+/*  FOR THE REPLAYER
+    ----------------  */
+extern bool host_verbose;
+void host_set_time(time_t now);
+void host_tick(void);                                  // deliver one minute tick at the current time
+void host_dict_reset(DictionaryIterator *iter);
+void host_dict_add_int(DictionaryIterator *iter, uint32_t key, int32_t value);
+void host_dict_add_cstring(DictionaryIterator *iter, uint32_t key, const char *string);
+void host_dict_add_bytes(DictionaryIterator *iter, uint32_t key, const uint8_t *data, uint16_t length);
+void host_deliver(DictionaryIterator *iter);           // as if it arrived from the phone
+const char *host_last_sent_status(void);               // status of the last message sent, or NULL
+void host_clear_sent(void);
+bool host_load_resource(uint32_t resource_id, const char *path);
+struct tm *host_localtime(const time_t *t);            // localtime() that is safe on several threads
+void host_track_allocations(bool on);                  // count heap allocations from now on
+long host_allocations(const char **last_site);         // how many so far, and where the last one was
@@ -0,0 +1,602 @@
+/*
+  Host implementation of the SDK subset in pebble.h.  Layers keep their
+  geometry so the face can ask for it back.  As on the watch, marking any
+  layer dirty redraws the whole window after the handler: every visible
+  layer's update proc runs, though the graphics calls draw nothing.  The
+  redraw is run before the next event rather than straight away, so the
+  replayer checks state as the face logged it, from inside the handler.
+*/
+
+#include <math.h>
+#include <stdarg.h>
+#include "pebble.h"
+
+#undef time
+#undef malloc
+#undef free
+
+struct Layer {
+  GRect frame, bounds;
+  bool hidden;
+  LayerUpdateProc update_proc;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+};
+
+struct BitmapLayer {
+  Layer layer;
+  GBitmap *bitmap;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+};
+
+struct AppTimer {
+  AppTimerCallback callback;
+  void *data;
+};
+
+bool host_verbose = false;
+static bool tracking_allocations = false;
+static long allocations = 0;
+static const char *last_allocation_site = NULL;
+
+#define DRAWN_LAYERS 16
+
+static Layer *drawn_layers[DRAWN_LAYERS];   // layers with an update proc
+static bool redraw_pending = false;
+
+static time_t host_now = 0;
+static TickHandler tick_handler = NULL;
+static AppMessageInboxReceived inbox_received = NULL;
+static DictionaryIterator outbox;
+static char last_sent_status[32];
+static bool sent = false;
+
+
+/*  HEAP
+    ----  */
+void *host_malloc(size_t size, const char *site) {
+  if (tracking_allocations) {
+    allocations++;
+    last_allocation_site = site;
+  }
+  return malloc(size);
+}
+
+
+void host_free(void *pointer) {
+  free(pointer);
+}
+
+
+static void *host_calloc(size_t size, const char *site) {
+  /* The SDK's own allocations, from the same heap as the face's. */
+  void *pointer = host_malloc(size, site);
+  if (pointer) memset(pointer, 0, size);
+  return pointer;
+}
+
+
+void host_track_allocations(bool on) {
+  tracking_allocations = on;
+}
+
+
+long host_allocations(const char **last_site) {
+  if (last_site) *last_site = last_allocation_site;
+  return allocations;
+}
+
+
+/*  CLOCK AND LOGGING
+    -----------------  */
+time_t host_time(time_t *t) {
+  if (t) *t = host_now;
+  return host_now;
+}
+
+
+void host_set_time(time_t now) {
+  host_now = now;
+}
+
+
+struct tm *host_localtime(const time_t *t) {
+  /* localtime() with a result per thread, for tools that run the face's code
+  on several threads at once (built with -Dlocaltime=host_localtime). */
+  static __thread struct tm result;
+  return localtime_r(t, &result);
+}
+
+
+static void redraw(void) {
+  if (!redraw_pending) return;
+  redraw_pending = false;
+  for (int i = 0; i < DRAWN_LAYERS; i++) {
+    Layer *layer = drawn_layers[i];
+    if (layer && !layer->hidden) layer->update_proc(layer, NULL);
+  }
+}
+
+
+void host_tick(void) {
+  redraw();
+  if (tick_handler) tick_handler(localtime(&host_now), MINUTE_UNIT);
+}
+
+
+void host_log(int level, const char *file, int line, const char *fmt, ...) {
+  if (!host_verbose) return;
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%s:%d> ", file, line);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+
+/*  GRAPHICS
+    --------  */
+int32_t sin_lookup(int32_t angle) {
+  return (int32_t) lround(sin(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+
+int32_t cos_lookup(int32_t angle) {
+  return (int32_t) lround(cos(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+  double angle = atan2(y, x);
+  if (angle < 0) angle += 2 * M_PI;
+  return (int32_t) (angle * TRIG_MAX_ANGLE / (2 * M_PI)) % TRIG_MAX_ANGLE;
+}
+
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  return host_calloc(sizeof(GBitmap), "gbitmap_create_with_resource");
+}
+
+
+GBitmap *gbitmap_create_blank(GSize size) {
+  GBitmap *bitmap = host_calloc(sizeof(GBitmap), "gbitmap_create_blank");
+  bitmap->row_size_bytes = ((size.w + 31) / 32) * 4;  // rows are word aligned
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->addr = host_calloc(bitmap->row_size_bytes * size.h, "gbitmap_create_blank");
+  return bitmap;
+}
+
+
+#define HOST_SUB_BITMAP 0x8000            // info_flags: the pixels belong to another bitmap
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base, GRect sub_rect) {
+  GBitmap *bitmap = host_calloc(sizeof(GBitmap), "gbitmap_create_as_sub_bitmap");
+  *bitmap = *base;
+  bitmap->info_flags |= HOST_SUB_BITMAP;
+  bitmap->bounds = sub_rect;
+  return bitmap;
+}
+
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap) return;
+  if (!(bitmap->info_flags & HOST_SUB_BITMAP)) free(bitmap->addr);
+  free(bitmap);
+}
+
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {}
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {}
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t radius, GCornerMask corners) {}
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {}
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                        GTextAlignment alignment, void *layout) {}
+void graphics_context_set_text_color(GContext *ctx, GColor color) {}
+
+
+GSize graphics_text_layout_get_content_size(const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                                            GTextAlignment alignment) {
+  /* Every byte half as wide as the box is high, about as a digit is. */
+  return GSize((int16_t) (strlen(text) * box.size.h / 2), box.size.h);
+}
+
+
+// Drawing is a no-op, so the frame buffer stays black.
+static uint8_t frame_buffer_pixels[20 * 168];
+static GBitmap frame_buffer = { frame_buffer_pixels, 20, 0, { { 0, 0 }, { 144, 168 } } };
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  return &frame_buffer;
+}
+
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  return true;
+}
+
+
+/*  LAYERS AND WINDOWS
+    ------------------  */
+static void layer_init(Layer *layer, GRect frame) {
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+
+Layer *layer_create(GRect frame) {
+  Layer *layer = host_calloc(sizeof(Layer), "layer_create");
+  layer_init(layer, frame);
+  return layer;
+}
+
+
+void layer_destroy(Layer *layer) {
+  for (int i = 0; i < DRAWN_LAYERS; i++) {
+    if (drawn_layers[i] == layer) drawn_layers[i] = NULL;
+  }
+  free(layer);
+}
+
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc proc) {
+  layer->update_proc = proc;
+  for (int i = 0; i < DRAWN_LAYERS; i++) {
+    if (!drawn_layers[i] || drawn_layers[i] == layer) {
+      drawn_layers[i] = layer;
+      return;
+    }
+  }
+  fprintf(stderr, "pebble_host: more than %d layers with an update proc\n", DRAWN_LAYERS);
+  exit(2);
+}
+
+
+void layer_add_child(Layer *parent, Layer *child) {}
+void layer_remove_from_parent(Layer *layer) {}
+void layer_mark_dirty(Layer *layer) { redraw_pending = true; }
+GRect layer_get_frame(Layer *layer) { return layer->frame; }
+GRect layer_get_bounds(Layer *layer) { return layer->bounds; }
+void layer_set_frame(Layer *layer, GRect frame) { layer->frame = frame; redraw_pending = true; }
+void layer_set_bounds(Layer *layer, GRect bounds) { layer->bounds = bounds; }
+void layer_set_hidden(Layer *layer, bool hidden) { layer->hidden = hidden; redraw_pending = true; }
+
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *layer = host_calloc(sizeof(TextLayer), "text_layer_create");
+  layer_init(&layer->layer, frame);
+  return layer;
+}
+
+
+void text_layer_destroy(TextLayer *layer) { free(layer); }
+void text_layer_set_text(TextLayer *layer, const char *text) { layer->text = text; redraw_pending = true; }
+void text_layer_set_text_color(TextLayer *layer, GColor color) {}
+void text_layer_set_background_color(TextLayer *layer, GColor color) {}
+void text_layer_set_font(TextLayer *layer, GFont font) {}
+void text_layer_set_text_alignment(TextLayer *layer, GTextAlignment alignment) {}
+GFont fonts_get_system_font(const char *key) { return key; }
+
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+  BitmapLayer *layer = host_calloc(sizeof(BitmapLayer), "bitmap_layer_create");
+  layer_init(&layer->layer, frame);
+  return layer;
+}
+
+
+void bitmap_layer_destroy(BitmapLayer *layer) { free(layer); }
+Layer *bitmap_layer_get_layer(BitmapLayer *layer) { return &layer->layer; }
+void bitmap_layer_set_bitmap(BitmapLayer *layer, GBitmap *bitmap) { layer->bitmap = bitmap; redraw_pending = true; }
+void bitmap_layer_set_background_color(BitmapLayer *layer, GColor color) {}
+void bitmap_layer_set_compositing_mode(BitmapLayer *layer, GCompOp mode) {}
+
+
+Window *window_create(void) {
+  Window *window = host_calloc(sizeof(Window), "window_create");
+  layer_init(&window->root, GRect(0, 0, 144, 168));
+  return window;
+}
+
+
+void window_destroy(Window *window) {
+  if (window->handlers.unload) window->handlers.unload(window);
+  free(window);
+}
+
+
+Layer *window_get_root_layer(Window *window) { return &window->root; }
+void window_set_window_handlers(Window *window, WindowHandlers handlers) { window->handlers = handlers; }
+
+
+void window_stack_push(Window *window, bool animated) {
+  if (window->handlers.load) window->handlers.load(window);
+  redraw_pending = true;
+  redraw();
+}
+
+
+/*  EVENTS AND TIMERS
+    -----------------  */
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler) { tick_handler = handler; }
+void tick_timer_service_unsubscribe(void) { tick_handler = NULL; }
+void accel_tap_service_subscribe(AccelTapHandler handler) {}
+void accel_tap_service_unsubscribe(void) {}
+void bluetooth_connection_service_subscribe(void (*handler)(bool connected)) {}
+void bluetooth_connection_service_unsubscribe(void) {}
+bool bluetooth_connection_service_peek(void) { return true; }
+void battery_state_service_subscribe(void (*handler)(BatteryChargeState charge)) {}
+void battery_state_service_unsubscribe(void) {}
+
+
+BatteryChargeState battery_state_service_peek(void) {
+  return (BatteryChargeState) { .charge_percent = 100, .is_charging = false, .is_plugged = false };
+}
+
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *data) {
+  // Timers never fire; the replayer only drives messages and ticks.
+  AppTimer *timer = host_calloc(sizeof(AppTimer), "app_timer_register");
+  timer->callback = callback;
+  timer->data = data;
+  return timer;
+}
+
+
+bool app_timer_reschedule(AppTimer *timer, uint32_t timeout_ms) { return true; }
+void app_timer_cancel(AppTimer *timer) { free(timer); }
+void app_event_loop(void) {}
+
+
+/*  APP MESSAGES
+    ------------  */
+static Tuple *dict_add(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t length) {
+  size_t size = sizeof(Tuple) + length;
+  if (iter->count >= HOST_DICT_TUPLES || iter->used + size > HOST_DICT_BYTES) return NULL;
+  Tuple *tuple = (Tuple*) (iter->buffer + iter->used);
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value->data, data, length);
+  iter->tuples[iter->count++] = tuple;
+  iter->used += (size + 3) & ~(size_t) 3;
+  return tuple;
+}
+
+
+void host_dict_reset(DictionaryIterator *iter) {
+  iter->count = 0;
+  iter->used = 0;
+}
+
+
+void host_dict_add_int(DictionaryIterator *iter, uint32_t key, int32_t value) {
+  dict_add(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+
+void host_dict_add_cstring(DictionaryIterator *iter, uint32_t key, const char *string) {
+  dict_add(iter, key, TUPLE_CSTRING, string, strlen(string) + 1);
+}
+
+
+void host_dict_add_bytes(DictionaryIterator *iter, uint32_t key, const uint8_t *data, uint16_t length) {
+  dict_add(iter, key, TUPLE_BYTE_ARRAY, data, length);
+}
+
+
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key) {
+  for (int i = 0; i < iter->count; i++) {
+    if (iter->tuples[i]->key == key) return iter->tuples[i];
+  }
+  return NULL;
+}
+
+
+int dict_write_tuplet(DictionaryIterator *iter, const Tuplet *tuplet) {
+  Tuple *tuple = NULL;
+  switch (tuplet->type) {
+    case TUPLE_CSTRING:
+      tuple = dict_add(iter, tuplet->key, TUPLE_CSTRING, tuplet->cstring.data, tuplet->cstring.length);
+      break;
+    case TUPLE_BYTE_ARRAY:
+      tuple = dict_add(iter, tuplet->key, TUPLE_BYTE_ARRAY, tuplet->bytes.data, tuplet->bytes.length);
+      break;
+    default:
+      tuple = dict_add(iter, tuplet->key, tuplet->type, &tuplet->integer.storage, tuplet->integer.width);
+      break;
+  }
+  return tuple ? 0 : 1;
+}
+
+
+AppMessageResult app_message_open(uint32_t inbox_size, uint32_t outbox_size) { return APP_MSG_OK; }
+
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iter) {
+  host_dict_reset(&outbox);
+  *iter = &outbox;
+  return APP_MSG_OK;
+}
+
+
+AppMessageResult app_message_outbox_send(void) {
+  // Only the status is kept; that is all the phone acts on.
+  Tuple *status = dict_find(&outbox, 0);
+  snprintf(last_sent_status, sizeof(last_sent_status), "%s", (status && status->type == TUPLE_CSTRING) ? status->value->cstring : "");
+  sent = true;
+  return APP_MSG_OK;
+}
+
+
+void app_message_register_inbox_received(AppMessageInboxReceived handler) { inbox_received = handler; }
+void app_message_register_inbox_dropped(AppMessageInboxDropped handler) {}
+void app_message_register_outbox_sent(AppMessageOutboxSent handler) {}
+void app_message_register_outbox_failed(AppMessageOutboxFailed handler) {}
+
+
+void host_deliver(DictionaryIterator *iter) {
+  redraw();
+  if (inbox_received) inbox_received(iter, NULL);
+}
+
+
+const char *host_last_sent_status(void) {
+  return sent ? last_sent_status : NULL;
+}
+
+
+void host_clear_sent(void) {
+  sent = false;
+}
+
+
+/*  PERSISTENT STORAGE
+    ------------------  */
+#define PERSIST_SLOTS 64
+
+typedef struct {
+  bool used;
+  uint32_t key;
+  int size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistSlot;
+
+static PersistSlot persist[PERSIST_SLOTS];
+
+
+static PersistSlot *persist_find(uint32_t key, bool create) {
+  PersistSlot *free_slot = NULL;
+  for (int i = 0; i < PERSIST_SLOTS; i++) {
+    if (persist[i].used && persist[i].key == key) return &persist[i];
+    if (!persist[i].used && !free_slot) free_slot = &persist[i];
+  }
+  if (!create || !free_slot) return NULL;
+  free_slot->used = true;
+  free_slot->key = key;
+  free_slot->size = 0;
+  return free_slot;
+}
+
+
+bool persist_exists(uint32_t key) {
+  return persist_find(key, false) != NULL;
+}
+
+
+int persist_get_size(uint32_t key) {
+  PersistSlot *slot = persist_find(key, false);
+  return slot ? slot->size : -1;
+}
+
+
+int persist_read_data(uint32_t key, void *buffer, size_t size) {
+  PersistSlot *slot = persist_find(key, false);
+  if (!slot) return -1;
+  int n = (size < (size_t) slot->size) ? (int) size : slot->size;
+  memcpy(buffer, slot->data, n);
+  return n;
+}
+
+
+int persist_write_data(uint32_t key, const void *data, size_t size) {
+  PersistSlot *slot = persist_find(key, true);
+  if (!slot) return -1;
+  if (size > PERSIST_DATA_MAX_LENGTH) size = PERSIST_DATA_MAX_LENGTH;
+  memcpy(slot->data, data, size);
+  slot->size = (int) size;
+  return (int) size;
+}
+
+
+int persist_delete(uint32_t key) {
+  PersistSlot *slot = persist_find(key, false);
+  if (!slot) return -1;
+  slot->used = false;
+  return 0;
+}
+
+
+int32_t persist_read_int(uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+
+int persist_write_int(uint32_t key, int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+
+int persist_read_string(uint32_t key, char *buffer, size_t size) {
+  int n = persist_read_data(key, buffer, size);
+  if (n > 0) buffer[n - 1] = '\0';
+  return n;
+}
+
+
+int persist_write_string(uint32_t key, const char *string) {
+  return persist_write_data(key, string, strlen(string) + 1);
+}
+
+
+/*  RESOURCES
+    ---------  */
+#define RESOURCE_SLOTS 4
+
+typedef struct {
+  uint32_t id;
+  uint8_t *data;
+  size_t size;
+} HostResource;
+
+static HostResource resources[RESOURCE_SLOTS];
+
+
+bool host_load_resource(uint32_t resource_id, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return false;
+  for (int i = 0; i < RESOURCE_SLOTS; i++) {
+    if (resources[i].data) continue;
+    fseek(file, 0, SEEK_END);
+    resources[i].size = (size_t) ftell(file);
+    fseek(file, 0, SEEK_SET);
+    resources[i].data = malloc(resources[i].size);
+    resources[i].id = resource_id;
+    bool ok = fread(resources[i].data, 1, resources[i].size, file) == resources[i].size;
+    fclose(file);
+    return ok;
+  }
+  fclose(file);
+  return false;
+}
+
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+  for (int i = 0; i < RESOURCE_SLOTS; i++) {
+    if (resources[i].data && resources[i].id == resource_id) return &resources[i];
+  }
+  return NULL;
+}
+
+
+size_t resource_size(ResHandle handle) {
+  return handle ? ((HostResource*) handle)->size : 0;
+}
+
+
+size_t resource_load_byte_range(ResHandle handle, uint32_t start, uint8_t *buffer, size_t size) {
+  HostResource *resource = handle;
+  if (!resource || start >= resource->size) return 0;
+  if (start + size > resource->size) size = resource->size - start;
+  memcpy(buffer, resource->data + start, size);
+  return size;
+}
@@ -0,0 +1,428 @@
+/*
+  Replay recorded phone/watch message traffic through the face on a computer.
+
+  Recording: set traceMessages in src/js/pebble-js-app.js and TRACE_MODE in
+  src/natural.c, run the face and save `pebble logs`.  Every message then
+  shows up as one line (anything before "TRACE" is ignored):
+
+    TRACE > <utc> key=value ...     phone to watch, as sent by the JS
+    TRACE < <utc> key=value ...     watch to phone, as received by the JS
+    TRACE = <watch time> key=value  the watch's state after a message
+
+  Replaying: each '>' message is decoded and handed to in_received_handler
+  at full speed, with the clock set to the time it was sent and a minute
+  tick delivered for every minute in between.  Each '<' line is checked
+  against what the face itself sent, and each '=' line against the state
+  write_trace_state() reports.  The handler time per message is measured
+  around the call only.
+
+    --repeat N   deliver every message N times in a row (bursts)
+    --mutate     also deliver each message once with each key missing and
+                 once with a malformed status, before the real one
+    --table F    sun table resource (default resources/data/suntable.bin)
+    --alloc      fail on any heap allocation after startup, and after the
+                 trace keep ticking until a week has passed, delivering the
+                 trace's messages again in turn every TIMEOUT
+    -v           show the face's log
+
+  The face is compiled for SDK 2 into this program, so the trace should come
+  from an SDK 2 watch (on SDK 3 the watch reports tz=0).  Build and run from
+  the repository root:
+
+    python tools/suntable.py resources/data/suntable.bin
+    gcc -O2 -std=c99 -D_DEFAULT_SOURCE -Wall -Itools/replay -o replay \
+        tools/replay/replay.c tools/replay/pebble_host.c \
+        src/ephemeris.c src/glyphs.c src/history.c src/raster.c src/sky.c src/suntable.c -lm
+    TZ=UTC ./replay trace.log
+
+  TZ=UTC makes the host's localtime() behave like SDK 2's, where time() is
+  already local.  The exit status is 1 if any check failed.
+
+  tools/replay/traces holds traces in `pebble logs` form for a watch in New
+  York: new_york.log (weather, a failed reply, an unknown key),
+  new_york_dst.log (the end of daylight saving time, which the phone's next
+  report brings),
+  new_york_push.log (push mode, then back to asking) and
+  new_york_push_quiet.log (a phone pushing, then quiet for twelve hours).
+  Their '=' lines came from the face with TRACE_MODE on, run through this
+  program; a trace from a watch goes next to them.  The state includes sky=,
+  the number of times the sky has been rasterized, so a change that redraws
+  it more often than it moves shows up as a mismatch.  The regression check
+  is that every one replays with no mismatches and no allocations after
+  startup:
+
+    for t in $(ls tools/replay/traces); do
+      TZ=UTC ./replay --alloc tools/replay/traces/$t || echo FAILED $t
+    done
+
+  Before the moons were atlases, every moon change allocated.  To see that,
+  build the same harness against the tree before tools/moon_atlas.py.  That
+  tree still had a background worker, which the -D flags stub out:
+
+    git worktree add ../before $(git log --diff-filter=A --format=%h -- tools/moon_atlas.py)^
+    cp tools/replay/replay.c tools/replay/pebble.h tools/replay/pebble_host.c ../before/tools/replay/
+    (cd ../before && python tools/suntable.py resources/data/suntable.bin &&
+     gcc -O2 -std=c99 -D_DEFAULT_SOURCE -Itools/replay -DAppWorkerMessage=void \
+         -D'app_worker_message_subscribe(handler)=true' -D'app_worker_message_unsubscribe()=true' \
+         -D'app_worker_is_running()=true' -D'app_worker_launch()=0' -o replay \
+         tools/replay/replay.c tools/replay/pebble_host.c \
+         src/ephemeris.c src/glyphs.c src/history.c src/raster.c src/sky.c src/suntable.c -lm)
+    TZ=UTC ../before/replay --table ../before/resources/data/suntable.bin --alloc \
+        tools/replay/traces/new_york_dst.log
+
+  That reports 268 allocations after startup over the week; this tree
+  reports 0.  Its state checks may differ too, as the sun table has changed
+  since.
+*/
+
+#define main natural_main
+#include "../../src/natural.c"
+#undef main
+#undef time
+
+#define MAX_FIELDS 16
+
+typedef struct {
+  const char *name;
+  uint32_t key;
+  TupleType type;
+} KeyName;
+
+// The names are the appKeys in appinfo.json.
+static const KeyName KEY_NAMES[] = {
+  {"status", KEY_STATUS, TUPLE_CSTRING},
+  {"tzOffset", KEY_TZOFFSET, TUPLE_INT},
+  {"sunrise", KEY_SUNRISE, TUPLE_INT},
+  {"sunset", KEY_SUNSET, TUPLE_INT},
+  {"temperature", KEY_TEMPERATURE, TUPLE_INT},
+  {"cityID", KEY_CITYID, TUPLE_INT},
+  {"latitude", KEY_LATITUDE, TUPLE_INT},
+  {"longitude", KEY_LONGITUDE, TUPLE_INT},
+  {"push", KEY_PUSH, TUPLE_INT}
+};
+
+typedef struct {
+  char direction;
+  long time;
+  int count;
+  char *names[MAX_FIELDS];
+  char *values[MAX_FIELDS];
+  char *rest;                       // everything after the time, for '=' lines
+  char *fields;                     // the split copy of rest
+} TraceLine;
+
+typedef struct {
+  long messages, deliveries, ticks, unknown_keys;
+  long sent_checks, sent_mismatches, state_checks, state_mismatches;
+  long allocations;
+  double handler_seconds, worst_seconds;
+} Stats;
+
+static Stats stats;
+static time_t watch_clock = 0;
+static int trace_offset = 0;        // the phone's last tzOffset, for messages without one
+static bool track_allocations = false;
+static long allocations_seen = 0;
+static int current_line = 0;        // 0 once the trace has run out
+static time_t start_clock = 0;
+static char **replies = NULL;       // the trace's '>' lines, for the rest of the week
+static int reply_count = 0;
+
+
+static double seconds_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+static bool parse_line(char *line, TraceLine *trace) {
+  /* Split a TRACE line in place.  Returns false for any other line. */
+  char *start = strstr(line, "TRACE ");
+  if (!start) return false;
+  line[strcspn(line, "\r\n")] = '\0';
+
+  char *cursor = start + 6;
+  trace->direction = *cursor;
+  if (trace->direction != '>' && trace->direction != '<' && trace->direction != '=') return false;
+  trace->time = strtol(cursor + 1, &cursor, 10);
+  while (*cursor == ' ') cursor++;
+  trace->rest = cursor;
+
+  trace->count = 0;
+  trace->fields = strdup(cursor);   // keep rest intact for '=' lines
+  for (char *field = strtok(trace->fields, " "); field && trace->count < MAX_FIELDS; field = strtok(NULL, " ")) {
+    char *equals = strchr(field, '=');
+    if (!equals) continue;
+    *equals = '\0';
+    trace->names[trace->count] = field;
+    trace->values[trace->count] = equals + 1;
+    trace->count++;
+  }
+  return true;
+}
+
+
+static const KeyName *find_key(const char *name) {
+  for (size_t i = 0; i < sizeof(KEY_NAMES) / sizeof(KEY_NAMES[0]); i++) {
+    if (strcmp(KEY_NAMES[i].name, name) == 0) return &KEY_NAMES[i];
+  }
+  return NULL;
+}
+
+
+static void build_message(const TraceLine *trace, DictionaryIterator *iter, int skip, bool bad_status) {
+  /* Encode the fields as the phone would, leaving out field 'skip' (-1 for none). */
+  host_dict_reset(iter);
+  for (int i = 0; i < trace->count; i++) {
+    if (i == skip) continue;
+    const KeyName *key = find_key(trace->names[i]);
+    if (!key) continue;
+    if (key->type == TUPLE_CSTRING && !bad_status) {
+      host_dict_add_cstring(iter, key->key, trace->values[i]);
+    } else {
+      host_dict_add_int(iter, key->key, (int32_t) strtol(trace->values[i], NULL, 10));
+    }
+  }
+}
+
+
+static void check_allocations(const char *event) {
+  /* Report heap allocations made since the last check. */
+  if (!track_allocations) return;
+  const char *site;
+  long count = host_allocations(&site);
+  if (count == allocations_seen) return;
+  char where[32];
+  if (current_line) snprintf(where, sizeof(where), "line %d", current_line);
+  else snprintf(where, sizeof(where), "day %ld", (long) (watch_clock - start_clock) / 86400 + 1);
+  printf("%s: %ld heap allocation%s during %s, the last in %s\n", where, count - allocations_seen,
+         count - allocations_seen == 1 ? "" : "s", event, site);
+  stats.allocations += count - allocations_seen;
+  allocations_seen = count;
+}
+
+
+static void advance_clock(time_t target) {
+  /* Move the watch clock forward, ticking at every minute boundary on the way.
+  Phone and watch timestamps can disagree by a second or so; never go back. */
+  if (watch_clock == 0) {
+    watch_clock = target;
+    host_set_time(watch_clock);
+    return;
+  }
+  if (target <= watch_clock) return;
+  time_t minute = watch_clock - (watch_clock % 60) + 60;
+  for (; minute <= target; minute += 60) {
+    host_set_time(minute);
+    host_tick();
+    stats.ticks++;
+    check_allocations("a minute tick");
+  }
+  watch_clock = target;
+  host_set_time(watch_clock);
+}
+
+
+static bool find_offset(const TraceLine *trace, int *offset) {
+  for (int i = 0; i < trace->count; i++) {
+    if (strcmp(trace->names[i], "tzOffset") == 0) {
+      *offset = (int) strtol(trace->values[i], NULL, 10);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+static time_t phone_to_watch_time(const TraceLine *trace) {
+  /* Phone times are UTC; SDK 2 watch time is local. */
+  find_offset(trace, &trace_offset);
+  return (time_t) trace->time - trace_offset;
+}
+
+
+static void find_first_offset(FILE *file) {
+  /* The first messages ("ready", "retrieve") carry no offset, so look ahead
+  for one rather than let the clock jump when it arrives. */
+  char line[1024];
+  TraceLine trace;
+  while (fgets(line, sizeof(line), file)) {
+    if (!parse_line(line, &trace)) continue;
+    bool found = trace.direction == '>' && find_offset(&trace, &trace_offset);
+    free(trace.fields);
+    if (found) break;
+  }
+  rewind(file);
+}
+
+
+static void deliver(DictionaryIterator *iter) {
+  double start = seconds_now();
+  host_deliver(iter);
+  double elapsed = seconds_now() - start;
+  stats.handler_seconds += elapsed;
+  if (elapsed > stats.worst_seconds) stats.worst_seconds = elapsed;
+  stats.deliveries++;
+  check_allocations("a message");
+}
+
+
+static void replay_message(const TraceLine *trace, int repeat, bool mutate) {
+  DictionaryIterator iter;
+  for (int i = 0; i < trace->count; i++) {
+    if (!find_key(trace->names[i])) stats.unknown_keys++;
+  }
+  advance_clock(phone_to_watch_time(trace));
+
+  if (mutate) {
+    for (int skip = 0; skip < trace->count; skip++) {
+      build_message(trace, &iter, skip, false);
+      deliver(&iter);
+    }
+    build_message(trace, &iter, -1, true);
+    deliver(&iter);
+  }
+  build_message(trace, &iter, -1, false);
+  for (int i = 0; i < repeat; i++) {
+    deliver(&iter);
+  }
+  stats.messages++;
+}
+
+
+static void keep_reply(const char *line) {
+  replies = realloc(replies, sizeof(char*) * (reply_count + 1));
+  replies[reply_count++] = strdup(line);
+}
+
+
+static void simulate_until(time_t end) {
+  /* Tick on until 'end', delivering the recorded messages again in turn
+  every TIMEOUT, as if the phone kept answering the face. */
+  DictionaryIterator iter;
+  TraceLine trace;
+  for (int next = 0; watch_clock < end; next = (next + 1) % reply_count) {
+    advance_clock(watch_clock + TIMEOUT < end ? watch_clock + TIMEOUT : end);
+    if (!reply_count) continue;
+    char line[1024];
+    strncpy(line, replies[next], sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    if (!parse_line(line, &trace)) continue;
+    build_message(&trace, &iter, -1, false);
+    deliver(&iter);
+    stats.messages++;
+    free(trace.fields);
+  }
+}
+
+
+static void check_sent(const TraceLine *trace, int line_number) {
+  advance_clock(phone_to_watch_time(trace));
+  const char *expected = NULL;
+  for (int i = 0; i < trace->count; i++) {
+    if (strcmp(trace->names[i], "status") == 0) expected = trace->values[i];
+  }
+  const char *actual = host_last_sent_status();
+  stats.sent_checks++;
+  if (!expected || !actual || strcmp(expected, actual) != 0) {
+    stats.sent_mismatches++;
+    printf("line %d: watch sent %s, recorded %s\n", line_number, actual ? actual : "nothing", expected ? expected : "nothing");
+  }
+  host_clear_sent();
+}
+
+
+static void check_state(const TraceLine *trace, int line_number) {
+  char state[192];
+  write_trace_state(state, sizeof(state));
+  stats.state_checks++;
+  if (strcmp(state, trace->rest) != 0) {
+    stats.state_mismatches++;
+    printf("line %d: state differs\n  recorded %s\n  replayed %s\n", line_number, trace->rest, state);
+  }
+}
+
+
+int main(int argc, char **argv) {
+  int repeat = 1;
+  bool mutate = false;
+  const char *table = "resources/data/suntable.bin";
+  int first_file = argc;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mutate") == 0) {
+      mutate = true;
+    } else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc) {
+      table = argv[++i];
+    } else if (strcmp(argv[i], "--alloc") == 0) {
+      track_allocations = true;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      host_verbose = true;
+    } else {
+      first_file = i;
+      break;
+    }
+  }
+  if (first_file >= argc || repeat < 1) {
+    fprintf(stderr, "usage: replay [--repeat N] [--mutate] [--table FILE] [--alloc] [-v] TRACE...\n");
+    return 2;
+  }
+  if (!host_load_resource(RESOURCE_ID_SUNTABLE, table)) {
+    fprintf(stderr, "replay: can't read %s; sun table lookups will fail\n", table);
+  }
+
+  bool started = false;
+  for (int f = first_file; f < argc; f++) {
+    FILE *file = fopen(argv[f], "r");
+    if (!file) {
+      perror(argv[f]);
+      return 2;
+    }
+    if (!started) find_first_offset(file);
+    char line[1024], copy[1024];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+      line_number++;
+      current_line = line_number;
+      strcpy(copy, line);
+      TraceLine trace;
+      if (!parse_line(line, &trace)) continue;
+      if (!started) {
+        advance_clock(phone_to_watch_time(&trace));
+        init();
+        started = true;
+        start_clock = watch_clock;
+        host_track_allocations(track_allocations);  // startup is over
+      }
+      if (track_allocations && trace.direction == '>') keep_reply(copy);
+      switch (trace.direction) {
+        case '>': replay_message(&trace, repeat, mutate); break;
+        case '<': check_sent(&trace, line_number); break;
+        case '=': check_state(&trace, line_number); break;
+      }
+      free(trace.fields);
+    }
+    fclose(file);
+  }
+  if (started && track_allocations) {
+    current_line = 0;
+    simulate_until(start_clock + (7 * 86400));
+  }
+  host_track_allocations(false);
+  if (started) deinit();
+
+  double mean = stats.deliveries ? stats.handler_seconds / stats.deliveries : 0;
+  printf("messages      %ld (%ld deliveries, %ld minute ticks)\n", stats.messages, stats.deliveries, stats.ticks);
+  printf("handler time  %.3f ms total, %.2f us mean, %.2f us worst\n",
+         stats.handler_seconds * 1e3, mean * 1e6, stats.worst_seconds * 1e6);
+  printf("throughput    %.0f messages/s\n", stats.handler_seconds > 0 ? stats.deliveries / stats.handler_seconds : 0);
+  printf("sent checks   %ld, %ld mismatched\n", stats.sent_checks, stats.sent_mismatches);
+  printf("state checks  %ld, %ld mismatched\n", stats.state_checks, stats.state_mismatches);
+  if (stats.unknown_keys) printf("unknown keys  %ld (ignored)\n", stats.unknown_keys);
+  if (track_allocations) {
+    printf("allocations   %ld after startup, over %.1f days\n", stats.allocations, (watch_clock - start_clock) / 86400.0);
+  }
+  return (stats.sent_mismatches || stats.state_mismatches || stats.allocations) ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+/* Mirror of the media list in appinfo.json; the SDK generates the real one. */
+
+enum {
+  RESOURCE_ID_INVALID = 0,
+  RESOURCE_ID_SUNTABLE,
+  RESOURCE_ID_NO_BLUETOOTH,
+  RESOURCE_ID_REFRESH,
+  RESOURCE_ID_EMPTY,
+  RESOURCE_ID_ERROR,
+  RESOURCE_ID_BATT_100,
+  RESOURCE_ID_BATT_80,
+  RESOURCE_ID_BATT_60,
+  RESOURCE_ID_BATT_40,
+  RESOURCE_ID_BATT_20,
+  RESOURCE_ID_BATT_10,
+  RESOURCE_ID_BATT_CHARGE,
+  RESOURCE_ID_CLOCKFACE_B,
+  RESOURCE_ID_CLOCKFACE_W,
+  RESOURCE_ID_SUN_B,
+  RESOURCE_ID_SUN_W,
+  RESOURCE_ID_MOONS_B,
+  RESOURCE_ID_MOONS_W,
+};
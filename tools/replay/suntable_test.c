@@ -0,0 +1,174 @@
+/*
+  Test of src/suntable.c on a computer: the watch's own lookup, fixed-point
+  trig and all, against the sun worked out from scratch.
+
+  For random days from 2020 to 2035 and random places within the table's
+  reach, sunrise, sunset and the three twilights come from
+  suntable_rise_and_set and suntable_twilight, reading the table through the
+  shim's resources.  The exact times come from Meeus's low-precision sun, the
+  one tools/suntable.py builds the table from, solved again at the time of
+  each crossing.  Days when the sun is above or below the altitude for less
+  than GRAZING minutes are skipped, as tools/suntable.py skips them: there a
+  hundredth of a degree moves the crossings by many minutes.  Otherwise the
+  table must give a crossing when the sun crosses and the right polar day or
+  night when it doesn't, and places beyond the table's reach must come back
+  UNAVAILABLE.  Build and run from the repository root:
+
+    python tools/suntable.py resources/data/suntable.bin
+    gcc -O2 -std=c99 -D_DEFAULT_SOURCE -Wall -Itools/replay -o suntable_test \
+        tools/replay/suntable_test.c tools/replay/pebble_host.c src/suntable.c -lm
+    ./suntable_test [TABLE]
+
+  The exit status is 1 if any crossing is off by more than MAX_ERROR
+  minutes (TWILIGHT_MAX_ERROR for twilight), or any polar answer is wrong.
+*/
+
+#include <pebble.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../src/suntable.h"
+
+#define SAMPLES 20000                   // per altitude
+#define FIRST_DAY 18262                 // 1 January 2020, in days since 1970
+#define LAST_DAY 24106                  // 31 December 2035
+#define LAT_MAX 84                      // as in tools/suntable.py
+#define MAX_ERROR 4.0                   // minutes, as in tools/suntable.py
+#define TWILIGHT_MAX_ERROR 5.0
+#define GRAZING 120
+#define RADIANS (M_PI / 180.0)
+
+static const char *NAMES[] = { "rise/set", "civil", "nautical", "astronomical" };
+static const double ALTITUDES[] = { -0.833, -6, -12, -18 };
+static const char *RESULT_NAMES[] = { "rise and set", "polar night", "polar day", "unavailable" };
+
+
+static void sun_position(double julian_day, double *declination, double *equation_of_time) {
+  /* Meeus's low-precision sun: declination in radians, equation of time in minutes. */
+  double t = (julian_day - 2451545.0) / 36525;
+  double l0 = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360) * RADIANS;
+  double m = (357.52911 + t * (35999.05029 - 0.0001537 * t)) * RADIANS;
+  double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+  double c = sin(m) * (1.914602 - t * (0.004817 + 0.000014 * t)) + sin(2 * m) * (0.019993 - 0.000101 * t) +
+             sin(3 * m) * 0.000289;
+  double omega = (125.04 - 1934.136 * t) * RADIANS;
+  double apparent = l0 + (c - 0.00569 - 0.00478 * sin(omega)) * RADIANS;
+  double eps0 = 23 + (26 + (21.448 - t * (46.815 + t * (0.00059 - t * 0.001813))) / 60) / 60;
+  double eps = (eps0 + 0.00256 * cos(omega)) * RADIANS;
+  *declination = asin(sin(eps) * sin(apparent));
+  double y = tan(eps / 2) * tan(eps / 2);
+  *equation_of_time = 4 * (y * sin(2 * l0) - 2 * e * sin(m) + 4 * e * y * sin(m) * cos(2 * l0) -
+                           0.5 * y * y * sin(4 * l0) - 1.25 * e * e * sin(2 * m)) / RADIANS;
+}
+
+
+static SuntableResult exact_event(int day, double latitude, double longitude, double altitude, int direction, double *minute) {
+  /* When the sun crosses 'altitude' going up (direction -1) or down (+1), in
+  UTC minutes from midnight on 'day' (days since 1970), taking the sun's
+  position at the crossing. */
+  double event = 720 - 4 * longitude;
+  for (int i = 0; i < 3; i++) {
+    double declination, equation_of_time;
+    sun_position(2440587.5 + day + (event / 1440), &declination, &equation_of_time);
+    double cos_h = (sin(altitude * RADIANS) - sin(latitude * RADIANS) * sin(declination)) /
+                   (cos(latitude * RADIANS) * cos(declination));
+    if (cos_h >= 1) return SUNTABLE_POLAR_NIGHT;
+    if (cos_h <= -1) return SUNTABLE_POLAR_DAY;
+    event = 720 - 4 * longitude - equation_of_time + direction * 4 * acos(cos_h) / RADIANS;
+  }
+  *minute = event;
+  return SUNTABLE_RISE_AND_SET;
+}
+
+
+static SuntableResult lookup(int level, int day, int32_t latitude, int32_t longitude, int *first, int *second) {
+  if (level == 0) return suntable_rise_and_set(day, latitude, longitude, first, second);
+  return suntable_twilight(day, latitude, longitude, level * 6, first, second);
+}
+
+
+static bool grazing(double length) {
+  return length < GRAZING || length > 1440 - GRAZING;
+}
+
+
+static int check_level(int level) {
+  /* Returns the number of failures. */
+  int failures = 0, count = 0, skipped = 0;
+  double worst = 0, total = 0;
+  for (int sample = 0; sample < SAMPLES; sample++) {
+    int day = FIRST_DAY + rand() % (LAST_DAY - FIRST_DAY + 1);
+    int32_t latitude = (rand() % (2 * LAT_MAX * 100 + 1)) - (LAT_MAX * 100);
+    int32_t longitude = (rand() % 36001) - 18000;
+    int first, second;
+    SuntableResult got = lookup(level, day, latitude, longitude, &first, &second);
+
+    double dawn = 0, dusk = 0;
+    SuntableResult want = exact_event(day, latitude / 100.0, longitude / 100.0, ALTITUDES[level], -1, &dawn);
+    if (want == SUNTABLE_RISE_AND_SET) {
+      want = exact_event(day, latitude / 100.0, longitude / 100.0, ALTITUDES[level], 1, &dusk);
+    }
+    if (want == SUNTABLE_RISE_AND_SET && grazing(dusk - dawn)) {
+      skipped++;
+      continue;
+    }
+    if (got == SUNTABLE_RISE_AND_SET && want != SUNTABLE_RISE_AND_SET && grazing(second - first)) {
+      skipped++;
+      continue;
+    }
+
+    if (got != want) {
+      printf("%s, day %d at %d, %d: table says %s, the sun %s\n", NAMES[level], day, (int) latitude,
+             (int) longitude, RESULT_NAMES[got], RESULT_NAMES[want]);
+      failures++;
+      continue;
+    }
+    if (got != SUNTABLE_RISE_AND_SET) continue;
+
+    double errors[2] = { fabs(first - dawn), fabs(second - dusk) };
+    double limit = level == 0 ? MAX_ERROR : TWILIGHT_MAX_ERROR;
+    for (int i = 0; i < 2; i++) {
+      if (errors[i] > limit) {
+        printf("%s, day %d at %d, %d: table says %d, the sun %.1f\n", NAMES[level], day, (int) latitude,
+               (int) longitude, i ? second : first, i ? dusk : dawn);
+        failures++;
+      }
+      if (errors[i] > worst) worst = errors[i];
+      total += errors[i];
+      count++;
+    }
+  }
+  printf("%-13s %d crossings, max error %.2f min, mean %.2f min, %d grazing days skipped\n",
+         NAMES[level], count, worst, count ? total / count : 0, skipped);
+  return failures;
+}
+
+
+static int check_reach(void) {
+  /* Beyond LAT_MAX the table refuses to answer. */
+  int failures = 0, first, second;
+  int32_t latitudes[] = { LAT_MAX * 100 + 1, -LAT_MAX * 100 - 1, 9000, -9000 };
+  for (int i = 0; i < 4; i++) {
+    for (int level = 0; level < 4; level++) {
+      if (lookup(level, FIRST_DAY, latitudes[i], 0, &first, &second) != SUNTABLE_UNAVAILABLE) {
+        printf("%s at latitude %d: answered beyond the table's reach\n", NAMES[level], (int) latitudes[i]);
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+
+int main(int argc, char **argv) {
+  const char *table = argc > 1 ? argv[1] : "resources/data/suntable.bin";
+  if (!host_load_resource(RESOURCE_ID_SUNTABLE, table)) {
+    fprintf(stderr, "suntable_test: can't read %s\n", table);
+    return 2;
+  }
+  srand(1);
+  int failures = check_reach();
+  for (int level = 0; level < 4; level++) failures += check_level(level);
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
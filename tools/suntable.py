@@ -0,0 +1,233 @@
+"""
+Generate resources/data/suntable.bin, the sun table read by src/suntable.c,
+and check it against an exact solar calculation.
+
+Layout (little endian, fixed width so the watch can read any entry on its own):
+
+    header    'S' 'U' 'N' VERSION LAT_MAX DAYS
+    noon      DAYS x int8    equation of time at lon 0, quarter minutes
+    decl      DAYS x int16   solar declination, hundredths of a degree
+
+The samples are spread evenly over a tropical year, counted from UTC noon
+on 1 January 1970, and averaged over the years around now.  Indexing by the
+sun's year rather than by the calendar's keeps the leap-year cycle out of
+the table, which near the poles is worth many minutes.  The watch
+interpolates between samples and solves for sunrise, sunset and each
+twilight from the declination, taking it again at the time of each
+crossing.  It refuses latitudes beyond LAT_MAX, the furthest checked.
+
+The check here runs a Python model of the watch's lookup, so the build can
+stop on a bad table.  tools/replay/suntable_test.c runs the C code itself,
+fixed-point trig and all, against the same exact calculation.
+
+Run directly to regenerate and print the error report:
+
+    python tools/suntable.py resources/data/suntable.bin
+"""
+
+from __future__ import division, print_function
+
+import math
+import os
+import random
+import struct
+import sys
+
+VERSION = 3
+DAYS = 183                 # samples per tropical year
+DAY_UNITS = 36000          # positions are in 1/36000 days, as on the watch
+YEAR_UNITS = 13148719      # a tropical year, 365.2422 days
+JD_EPOCH = 2440588.0       # UTC noon, 1 January 1970
+SUN_ALTITUDE = -0.833      # refraction plus solar radius, degrees
+POLAR_NIGHT = 'polar night'
+POLAR_DAY = 'polar day'
+
+CYCLES = range(2020, 2036) # years averaged over
+CHECK_YEARS = range(2020, 2036)
+LAT_MAX = 84               # degrees; checked up to here, refused beyond
+MAX_ERROR = 4.0            # minutes
+TWILIGHT_MAX_ERROR = 5.0   # minutes
+TWILIGHT_CHECK_LATITUDE = LAT_MAX   # the face draws twilight wherever it uses the table
+TWILIGHT_DEPRESSIONS = (6, 12, 18)
+GRAZING = 120              # minutes, see check()
+CHECK_SAMPLES = 20000
+
+
+# Exact calculation (Meeus, as used by the NOAA solar calculator)
+# ---------------------------------------------------------------
+
+def julian_day(year, day_of_year, minutes=720.0):
+    a = (14 - 1) // 12
+    y = year + 4800 - a
+    m = 1 + 12 * a - 3
+    jan1 = 1 + (153 * m + 2) // 5 + 365 * y + y // 4 - y // 100 + y // 400 - 32045
+    return jan1 - 0.5 + day_of_year + minutes / 1440.0
+
+
+def solar_position(jd):
+    """Return (declination in degrees, equation of time in minutes)."""
+    t = (jd - 2451545.0) / 36525.0
+    l0 = math.radians((280.46646 + t * (36000.76983 + t * 0.0003032)) % 360)
+    m = math.radians(357.52911 + t * (35999.05029 - 0.0001537 * t))
+    e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t)
+    c = (math.sin(m) * (1.914602 - t * (0.004817 + 0.000014 * t)) +
+         math.sin(2 * m) * (0.019993 - 0.000101 * t) +
+         math.sin(3 * m) * 0.000289)
+    omega = math.radians(125.04 - 1934.136 * t)
+    apparent = math.radians(math.degrees(l0) + c - 0.00569 - 0.00478 * math.sin(omega))
+    eps0 = 23 + (26 + (21.448 - t * (46.815 + t * (0.00059 - t * 0.001813))) / 60) / 60
+    eps = math.radians(eps0 + 0.00256 * math.cos(omega))
+    declination = math.degrees(math.asin(math.sin(eps) * math.sin(apparent)))
+    y = math.tan(eps / 2) ** 2
+    eot = 4 * math.degrees(y * math.sin(2 * l0) - 2 * e * math.sin(m) +
+                           4 * e * y * math.sin(m) * math.cos(2 * l0) -
+                           0.5 * y * y * math.sin(4 * l0) - 1.25 * e * e * math.sin(2 * m))
+    return declination, eot
+
+
+def hour_angle(latitude, declination, altitude=SUN_ALTITUDE):
+    """Half the time above 'altitude' in minutes, or POLAR_NIGHT or POLAR_DAY
+    if the sun stays below or above it."""
+    lat = math.radians(latitude)
+    dec = math.radians(declination)
+    cos_h = ((math.sin(math.radians(altitude)) - math.sin(lat) * math.sin(dec)) /
+             (math.cos(lat) * math.cos(dec)))
+    if cos_h > 1:
+        return POLAR_NIGHT
+    if cos_h < -1:
+        return POLAR_DAY
+    return 4 * math.degrees(math.acos(cos_h))
+
+
+def exact_event(year, day_of_year, latitude, longitude, rising, altitude=SUN_ALTITUDE):
+    """UTC minutes from midnight of the sun crossing 'altitude' (sunrise or
+    sunset by default), or None if it doesn't."""
+    minutes = 720.0 - 4 * longitude
+    for _ in range(3):
+        declination, eot = solar_position(julian_day(year, day_of_year, minutes))
+        h = hour_angle(latitude, declination, altitude)
+        if h in (POLAR_NIGHT, POLAR_DAY):
+            return None
+        noon = 720 - 4 * longitude - eot
+        minutes = noon - h if rising else noon + h
+    return minutes
+
+
+# Table
+# -----
+
+def build_table():
+    noon = []
+    decl = []
+    for s in range(DAYS):
+        offset = s * YEAR_UNITS / DAYS / DAY_UNITS
+        positions = [solar_position(JD_EPOCH + offset + (year - 1970) * YEAR_UNITS / DAY_UNITS) for year in CYCLES]
+        declination = sum(p[0] for p in positions) / len(positions)
+        eot = sum(p[1] for p in positions) / len(positions)
+        noon.append(int(round(eot * 4)))
+        decl.append(int(round(declination * 100)))
+    return noon, decl
+
+
+def pack_table(noon, decl):
+    data = bytearray(b'SUN')
+    data += struct.pack('<BBB', VERSION, LAT_MAX, DAYS)
+    data += struct.pack('<%db' % DAYS, *noon)
+    data += struct.pack('<%dh' % DAYS, *decl)
+    return data
+
+
+def cdiv(a, b):
+    """Integer division that truncates toward zero, as C does."""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def interpolate(section, day, units):
+    """Mirror of interpolate() in src/suntable.c: 'section' at 'units'
+    (1/36000 days) after UTC noon on 'day', days since 1 January 1970."""
+    position = (day * DAY_UNITS + units) % YEAR_UNITS
+    scaled = position * DAYS
+    s0 = scaled // YEAR_UNITS
+    fd = scaled % YEAR_UNITS
+    return cdiv(section[s0] * (YEAR_UNITS - fd) + section[(s0 + 1) % DAYS] * fd, YEAR_UNITS)
+
+
+def crossings(noon, decl, day, latitude, longitude, altitude):
+    """Model of crossings() in src/suntable.c.  The watch uses fixed-point
+    trig, so this matches it to within a fraction of a minute rather than
+    exactly.  Latitude and longitude are in hundredths of a degree.  Returns
+    (first, second) in UTC minutes, or (POLAR_*, None)."""
+    def half_day(units):
+        return hour_angle(latitude / 100.0, interpolate(decl, day, units) / 100.0, altitude)
+
+    h = half_day(-longitude)
+    if h in (POLAR_NIGHT, POLAR_DAY):
+        return h, None
+    h4 = int(h * 4)
+    rise, sunset = half_day(-longitude - cdiv(h4 * 25, 4)), half_day(-longitude + cdiv(h4 * 25, 4))
+    rise4 = h4 if rise in (POLAR_NIGHT, POLAR_DAY) else int(rise * 4)
+    set4 = h4 if sunset in (POLAR_NIGHT, POLAR_DAY) else int(sunset * 4)
+    noon4 = 720 * 4 - interpolate(noon, day, -longitude) - cdiv(longitude * 16, 100)
+    return cdiv(noon4 - rise4, 4), cdiv(noon4 + set4, 4)
+
+
+def check(noon, decl, latitude_max, altitudes, samples=CHECK_SAMPLES, seed=1):
+    """Compare the watch's crossings against the exact calculation on random
+    days and places within 'latitude_max'.  Returns (max error, mean error)
+    in minutes.
+
+    When the sun only just crosses an altitude, the crossing times swing by
+    many minutes for a hundredth of a degree of declination, and no table
+    pins them down.  Days when the sun is above or below that altitude for
+    less than GRAZING minutes are skipped; at worst the face draws one of
+    them a little long or short."""
+    rng = random.Random(seed)
+    worst = 0.0
+    total = 0.0
+    count = 0
+    while count < samples:
+        year = rng.choice(CHECK_YEARS)
+        day = rng.randrange(365)
+        latitude = rng.uniform(-latitude_max, latitude_max)
+        longitude = rng.uniform(-180, 180)
+        altitude = rng.choice(altitudes)
+        days = int(julian_day(year, day) - JD_EPOCH)
+        first, second = crossings(noon, decl, days, int(latitude * 100), int(longitude * 100), altitude)
+        exact_first = exact_event(year, day, latitude, longitude, True, altitude)
+        exact_second = exact_event(year, day, latitude, longitude, False, altitude)
+        if second is None or exact_first is None or exact_second is None:
+            continue
+        if not GRAZING < exact_second - exact_first < 1440 - GRAZING:
+            continue
+        for got, want in ((first, exact_first), (second, exact_second)):
+            error = abs(got - want)
+            worst = max(worst, error)
+            total += error
+            count += 1
+    return worst, total / count
+
+
+def generate(path, force=False):
+    """Write the table to 'path' unless it is newer than this script.  Fails if
+    the table is off by more than MAX_ERROR minutes anywhere it was checked."""
+    if not force and os.path.exists(path) and os.path.getmtime(path) >= os.path.getmtime(__file__):
+        return
+    noon, decl = build_table()
+    worst, mean = check(noon, decl, LAT_MAX, (SUN_ALTITUDE,))
+    print('suntable: max error %.2f min, mean %.2f min (|lat| <= %d)' % (worst, mean, LAT_MAX))
+    if worst > MAX_ERROR:
+        raise ValueError('suntable: error %.2f min exceeds %.2f min' % (worst, MAX_ERROR))
+    worst, mean = check(noon, decl, TWILIGHT_CHECK_LATITUDE, [-d for d in TWILIGHT_DEPRESSIONS], seed=2)
+    print('suntable: twilight max error %.2f min, mean %.2f min (|lat| <= %d)' % (worst, mean, TWILIGHT_CHECK_LATITUDE))
+    if worst > TWILIGHT_MAX_ERROR:
+        raise ValueError('suntable: twilight error %.2f min exceeds %.2f min' % (worst, TWILIGHT_MAX_ERROR))
+    directory = os.path.dirname(path)
+    if directory and not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(path, 'wb') as f:
+        f.write(pack_table(noon, decl))
+
+
+if __name__ == '__main__':
+    generate(sys.argv[1] if len(sys.argv) > 1 else 'resources/data/suntable.bin', force=True)